@@ -64,6 +64,71 @@ public:
         return {};
     }
 
+    void setHighQualityPreview (bool enabled)
+    {
+        if (auto* f = getUserSettings()) {
+            f->setValue ("highQualityPreview", enabled);
+        }
+    }
+    bool highQualityPreview() const
+    {
+        if (auto* f = const_cast<Settings*> (this)->getUserSettings())
+            return f->getBoolValue ("highQualityPreview", true);
+        return true;
+    }
+
+    void setSinglePassResampling (bool enabled)
+    {
+        if (auto* f = getUserSettings()) {
+            f->setValue ("singlePassResampling", enabled);
+        }
+    }
+    bool singlePassResampling() const
+    {
+        if (auto* f = const_cast<Settings*> (this)->getUserSettings())
+            return f->getBoolValue ("singlePassResampling", false);
+        return false;
+    }
+
+    void setMatchDeviceSampleRate (bool enabled)
+    {
+        if (auto* f = getUserSettings()) {
+            f->setValue ("matchDeviceSampleRate", enabled);
+        }
+    }
+    bool matchDeviceSampleRate() const
+    {
+        if (auto* f = const_cast<Settings*> (this)->getUserSettings())
+            return f->getBoolValue ("matchDeviceSampleRate", false);
+        return false;
+    }
+
+    void setLiveInput (bool enabled)
+    {
+        if (auto* f = getUserSettings()) {
+            f->setValue ("liveInput", enabled);
+        }
+    }
+    bool liveInput() const
+    {
+        if (auto* f = const_cast<Settings*> (this)->getUserSettings())
+            return f->getBoolValue ("liveInput", false);
+        return false;
+    }
+
+    void setIdleTimeout (int seconds)
+    {
+        if (auto* f = getUserSettings()) {
+            f->setValue ("idleTimeout", seconds);
+        }
+    }
+    int idleTimeout() const
+    {
+        if (auto* f = const_cast<Settings*> (this)->getUserSettings())
+            return f->getIntValue ("idleTimeout", 0);
+        return 0;
+    }
+
     void flush()
     {
         if (auto* f = getUserSettings())
@@ -3,28 +3,76 @@
 
 #include "audioengine.hpp"
 #include "application.hpp"
+#include "wave64format.hpp"
 #include "../params.hpp"
 
 namespace retuner {
 namespace app {
 
+namespace detail {
+/** Cross-fade length when switching between realtime and pre-rendered audio */
+static constexpr int hqFadeSamples = 2048;
+/** Filter quality used to convert file rate audio to the device rate */
+static constexpr auto playbackResamplerQuality = dsp::Resampler::Quality::High;
+/** How far ahead pre-rendered audio must be ready before the realtime stretcher may rest */
+static constexpr double hqWarmupSeconds = 0.5;
+/** Cross-fade length when switching between original and retuned audio */
+static constexpr int abFadeSamples = 512;
+/** Original audio kept for A/B compares, enough to cover the stretcher's latency */
+static constexpr double dryHistorySeconds = 2.0;
+/** Shortest loop region */
+static constexpr double minLoopSeconds = 0.1;
+/** Longest loop region, which is pinned in memory twice over */
+static constexpr double maxLoopSeconds = 120.0;
+/** Cross-fade from the end of a loop into its start */
+static constexpr double loopFadeSeconds = 0.01;
+/** Device buffer size asked for in live input mode */
+static constexpr int liveBufferSize = 64;
+/** Opening of a queued file decoded when it's joined onto the playing one */
+static constexpr double preloadSeconds = 2.0;
+/** How long the stretcher is left to ring out after playback stops before processing stops too */
+static constexpr double idleTailSeconds = 0.5;
+/** Smallest read-ahead buffer in samples */
+static constexpr int minReadAhead = 32768;
+/** Device blocks the read-ahead buffer holds at least */
+static constexpr int readAheadBlocks = 16;
+/** Multiple of the slowest recent read the read-ahead buffer covers */
+static constexpr double readAheadMargin = 4.0;
+/** Largest read-ahead buffer */
+static constexpr double maxReadAheadSeconds = 10.0;
+} // namespace detail
+
 AudioEngine::AudioEngine()
     : _audioFileThread ("Audio File Thread")
 {
     // Start the audio file thread for background audio processing
     _audioFileThread.startThread(); // Use default priority
+    _threadPolicy.applyBackground (_audioFileThread);
 
     // Set up audio formats
     setupAudioFormats();
 
     // Initialize audio components
+    _playlist = std::make_unique<PlaylistSource>();
     _transportSource = std::make_unique<juce::AudioTransportSource>();
     _mixerSource = std::make_unique<juce::MixerAudioSource>();
     _retunerProcessor = std::make_unique<retuner::Processor>();
+    _preRenderer = std::make_unique<PreRenderer> (_threadPolicy);
+    _retunerProcessor->setSeekCrossfade (true);
+
+    // Seek indexes live beside the settings
+    if (auto* props = Application::settingsRef().getUserSettings())
+        _seekIndex = std::make_unique<Mp3SeekIndexCache> (props->getFile().getParentDirectory().getChildFile ("SeekIndex"));
 
     // Attempt to restore processor state
     {
         auto& settings = Application::settingsRef();
+        _hqPreview = settings.highQualityPreview();
+        _singlePass = settings.singlePassResampling();
+        _matchSampleRate = settings.matchDeviceSampleRate();
+        _liveInput = settings.liveInput();
+        _idleTimeout = settings.idleTimeout();
+        _retunerProcessor->setLowLatency (_liveInput.load());
         auto b64 = settings.processorStateBase64();
         if (b64.isNotEmpty()) {
             juce::MemoryBlock mb;
@@ -57,10 +105,10 @@ bool AudioEngine::initialize()
 
     // Prefer 0 inputs and 2 outputs for media playback; restore previous XML if present
     auto audioError = _deviceManager.initialise (
-        0,               // Number of input channels
-        2,               // Number of output channels
-        deviceXml.get(), // Restore settings if available
-        true             // Select default device if no settings
+        _liveInput ? 2 : 0, // Number of input channels
+        2,                  // Number of output channels
+        deviceXml.get(),    // Restore settings if available
+        true                // Select default device if no settings
     );
 
     if (audioError.isNotEmpty()) {
@@ -73,6 +121,12 @@ bool AudioEngine::initialize()
 
     _isInitialized = true;
 
+    if (_liveInput.load())
+        configureLiveDevice (true);
+
+    // Watch for pitch changes that need a new pre-render and keep the queue moving
+    startTimer (250);
+
     return true;
 }
 
@@ -81,12 +135,10 @@ void AudioEngine::shutdown()
     if (! _isInitialized.load())
         return;
 
+    stopTimer();
+
     // Save current device state to settings
-    if (auto state = _deviceManager.createStateXml()) {
-        auto& settings = Application::settingsRef();
-        settings.setAudioDeviceStateXML (state.get());
-        settings.flush();
-    }
+    saveDeviceState();
 
     // Save current processor state (Base64) to settings
     if (_retunerProcessor) {
@@ -105,10 +157,15 @@ void AudioEngine::shutdown()
     _deviceManager.removeAudioCallback (this);
     _deviceManager.removeChangeListener (this);
 
+    // Stop background rendering before the sources go away
+    _preRenderer.reset();
+    _seekIndex.reset();
+
     // Clean up audio sources
+    _mixerSource->releaseResources();
     _mixerSource->removeAllInputs();
     _transportSource.reset();
-    _readerSource.reset();
+    _playlist.reset();
     _mixerSource.reset();
     _retunerProcessor.reset();
 
@@ -125,6 +182,7 @@ void AudioEngine::setupAudioFormats()
 {
     // Register standard audio formats
     _formatManager.registerBasicFormats();
+    _formatManager.registerFormat (new Wave64AudioFormat(), false);
 }
 
 bool AudioEngine::loadAudioFile (const juce::File& file)
@@ -136,41 +194,60 @@ bool AudioEngine::loadAudioFile (const juce::File& file)
 
     // Stop current playback
     stop();
+    dropLoop();
 
     // Try to create a reader for the file
-    auto* reader = _formatManager.createReaderFor (file);
+    auto reader = createReaderFor (file);
 
     if (reader == nullptr) {
         notifyError ("Unable to load audio file: " + file.getFileName());
         return false;
     }
 
-    // Create a new reader source
-    auto newReaderSource = std::make_unique<juce::AudioFormatReaderSource> (reader, true);
+    const auto sampleRate = reader->sampleRate;
+    const auto length = reader->lengthInSamples;
 
-    // Replace current sources (thread-safe)
+    // Replace the playlist with the new file (thread-safe)
     {
         juce::ScopedLock lock (_callbackLock);
 
-        if (_readerSource) {
-            _transportSource->setSource (nullptr);
-            _readerSource.reset();
-        }
-
-        _readerSource = std::move (newReaderSource);
-
-        // Set source with proper sample rate correction
-        // Pass the actual file sample rate so JUCE can resample correctly
-        _transportSource->setSource (_readerSource.get(),
-                                     32768,              // Read-ahead buffer for smooth playback
-                                     &_audioFileThread,  // Background thread for buffering
-                                     reader->sampleRate, // Source file sample rate (NOT device rate!)
-                                     2);                 // Max channels
+        _transportSource->setSource (nullptr);
+        _readAheadSamples = 0;
+        _playlist->reset (std::move (reader), file);
+        _currentItem = 0;
+        _itemStart = 0;
+        _itemLength = length;
+        _fileSampleRate = sampleRate;
+        _dryStart = _dryEnd = 0;
+        configureSources();
     }
 
     _currentFile = file;
     _currentFileName = file.getFileName();
+    _preloadAttempted = false;
+
+    if (_matchSampleRate)
+        switchDeviceSampleRate (_fileSampleRate);
+
+    if (_hqPreview.load())
+        restartPreRender();
 
+    notifyFileLoaded (file);
+    return true;
+}
+
+std::unique_ptr<juce::AudioFormatReader> AudioEngine::createReaderFor (const juce::File& file)
+{
+    // MP3s seek through a cached frame index once one has been built
+    if (_seekIndex != nullptr)
+        if (auto reader = _seekIndex->createReaderFor (file))
+            return reader;
+
+    return std::unique_ptr<juce::AudioFormatReader> (_formatManager.createReaderFor (file));
+}
+
+void AudioEngine::notifyFileLoaded (const juce::File& file)
+{
     // Save last loaded file to settings
     auto& settings = Application::settingsRef();
     settings.setLastLoadedFile (file.getFullPathName());
@@ -183,13 +260,33 @@ bool AudioEngine::loadAudioFile (const juce::File& file)
                 onFileLoaded (file);
         });
     }
+}
 
-    return true;
+void AudioEngine::enqueue (const juce::File& file)
+{
+    if (! hasFileLoaded()) {
+        loadAudioFile (file);
+        return;
+    }
+
+    // The timer joins it onto the playing file ahead of time
+    _queue.add (file);
+}
+
+void AudioEngine::clearQueue()
+{
+    _queue.clear();
+    _playlist->truncate (_currentItem.load());
+    _preloadAttempted = false;
 }
 
 void AudioEngine::play()
 {
+    resumeDevice();
+
     if (_transportSource) {
+        if (! _transportSource->isPlaying())
+            seekWithPreroll (getPosition());
         _transportSource->start();
         if (onPlaybackStateChanged)
             onPlaybackStateChanged (true);
@@ -209,7 +306,9 @@ void AudioEngine::stop()
 {
     if (_transportSource) {
         _transportSource->stop();
-        _transportSource->setPosition (0.0);
+        _transportSource->setPosition (static_cast<double> (_itemStart) / _fileSampleRate);
+        if (_loop != nullptr)
+            _loopJump = 0;
         if (onPlaybackStateChanged)
             onPlaybackStateChanged (false);
     }
@@ -222,24 +321,227 @@ bool AudioEngine::isPlaying() const
 
 bool AudioEngine::isPaused() const
 {
-    return _transportSource ? ! _transportSource->isPlaying() && _transportSource->getCurrentPosition() > 0.0 : false;
+    return _transportSource ? ! _transportSource->isPlaying() && getPosition() > 0.0 : false;
 }
 
 void AudioEngine::setPosition (double seconds)
 {
     if (_transportSource) {
-        _transportSource->setPosition (seconds);
+        if (_transportSource->isPlaying())
+            seekWithPreroll (seconds);
+        else if (_loop != nullptr)
+            _loopJump = loopOffset (seconds);
+        else
+            _transportSource->setPosition (static_cast<double> (_itemStart) / _fileSampleRate + seconds);
     }
 }
 
+void AudioEngine::seekWithPreroll (double seconds)
+{
+    // Start the transport a little early so the audio thread can pre-roll the
+    // stretcher from what leads up to the new position. The lock keeps the
+    // callback from playing the pre-roll before the seek is flagged. The
+    // stretcher runs whether or not the retuned audio is heard.
+    const juce::ScopedLock lock (_callbackLock);
+
+    const auto inputRate = _singlePassActive ? _fileSampleRate : _deviceSampleRate;
+    const auto preroll = juce::jlimit (0.0, juce::jmax (0.0, seconds), _retunerProcessor->pitchPrerollLength() / inputRate);
+    _seekPrerollSamples = juce::roundToInt (preroll * inputRate);
+    _replayPosition = _replayEnd = 0;
+    _seekPending = true;
+
+    if (_loop != nullptr)
+        _loopJump = loopOffset (seconds - preroll);
+    else
+        _transportSource->setPosition (static_cast<double> (_itemStart) / _fileSampleRate + seconds - preroll);
+}
+
+juce::int64 AudioEngine::loopOffset (double seconds) const noexcept
+{
+    return static_cast<juce::int64> (std::llround (seconds * _fileSampleRate)) - _loop->start;
+}
+
+bool AudioEngine::setLoopRegion (double startSeconds, double endSeconds)
+{
+    if (! hasFileLoaded() || _transportSource == nullptr)
+        return false;
+
+    const auto start = juce::jlimit<juce::int64> (0, _itemLength, static_cast<juce::int64> (startSeconds * _fileSampleRate));
+    const auto maxEnd = juce::jmin (_itemLength, start + static_cast<juce::int64> (_fileSampleRate * detail::maxLoopSeconds));
+    const auto end = juce::jlimit<juce::int64> (start, maxEnd, static_cast<juce::int64> (endSeconds * _fileSampleRate));
+    if (end - start < static_cast<juce::int64> (_fileSampleRate * detail::minLoopSeconds))
+        return false;
+
+    auto loop = std::make_unique<Loop>();
+    loop->start = start;
+    loop->length = end - start;
+    loop->fade = static_cast<int> (juce::jmin<juce::int64> (juce::roundToInt (_fileSampleRate * detail::loopFadeSeconds), start, loop->length / 2));
+
+    // Decode the region once, along with what leads into it for the wrap cross-fade
+    auto reader = createReaderFor (_currentFile);
+    if (reader == nullptr) {
+        notifyError ("Unable to read the loop region from " + _currentFileName);
+        return false;
+    }
+
+    juce::AudioBuffer<float> region (2, static_cast<int> (loop->length) + loop->fade);
+    reader->read (&region, 0, region.getNumSamples(), start - loop->fade, true, true);
+    loop->original = foldLoop (region, loop->fade);
+
+    // Carry on from the current position if it's inside the loop
+    const auto loopStart = static_cast<double> (start) / _fileSampleRate;
+    const auto loopEnd = static_cast<double> (end) / _fileSampleRate;
+    const auto current = getPosition();
+    const auto resume = current >= loopStart && current < loopEnd ? current : loopStart;
+
+    {
+        const juce::ScopedLock lock (_callbackLock);
+        std::swap (_loop, loop);
+        _loopRead = loopOffset (resume);
+    }
+
+    // Only the loop needs rendering from now on
+    if (_preRenderer != nullptr) {
+        _preRenderer->setFocus ({ start - _loop->fade, end });
+        if (_preRenderer->file() != _currentFile)
+            restartPreRender();
+    }
+
+    if (isPlaying())
+        seekWithPreroll (resume);
+
+    return true;
+}
+
+void AudioEngine::clearLoopRegion()
+{
+    if (_loop == nullptr)
+        return;
+
+    const auto position = getPosition();
+    dropLoop();
+
+    // The transport picks up from where the loop was
+    if (isPlaying())
+        seekWithPreroll (position);
+    else
+        _transportSource->setPosition (static_cast<double> (_itemStart) / _fileSampleRate + position);
+}
+
+juce::Range<double> AudioEngine::loopRegion() const
+{
+    if (_loop == nullptr)
+        return {};
+    return { static_cast<double> (_loop->start) / _fileSampleRate,
+             static_cast<double> (_loop->start + _loop->length) / _fileSampleRate };
+}
+
+void AudioEngine::dropLoop()
+{
+    std::unique_ptr<Loop> loop;
+    {
+        const juce::ScopedLock lock (_callbackLock);
+        std::swap (loop, _loop);
+    }
+
+    if (loop != nullptr && _preRenderer != nullptr) {
+        _preRenderer->clearFocus();
+        if (! _hqPreview.load())
+            _preRenderer->stop();
+    }
+}
+
+void AudioEngine::updateLoop()
+{
+    if (_loop == nullptr || _preRenderer == nullptr || _retunerProcessor == nullptr)
+        return;
+
+    // Pin a new render once the pre-renderer has caught up with the pitch
+    const auto ratio = _preRenderer->pitchRatio();
+    if (_loop->retuned.getNumSamples() > 0 && juce::approximatelyEqual (ratio, _loop->retunedRatio))
+        return;
+    if (! juce::approximatelyEqual (ratio, _retunerProcessor->pitchRatio()))
+        return;
+
+    const auto start = _loop->start - _loop->fade;
+    const int length = static_cast<int> (_loop->length) + _loop->fade;
+    juce::AudioBuffer<float> region (2, length);
+    if (! _preRenderer->read (region, 0, start, length))
+        return;
+
+    auto retuned = foldLoop (region, _loop->fade);
+    {
+        const juce::ScopedLock lock (_callbackLock);
+        std::swap (_loop->retuned, retuned);
+        _loop->retunedRatio = ratio;
+    }
+}
+
+juce::AudioBuffer<float> AudioEngine::foldLoop (const juce::AudioBuffer<float>& region, int fade)
+{
+    // The region starts with the fade's worth of audio from before the loop.
+    // Blending that into the end makes the wrap back to the start continuous.
+    const int length = region.getNumSamples() - fade;
+    juce::AudioBuffer<float> loop (region.getNumChannels(), length);
+    for (int ch = 0; ch < region.getNumChannels(); ++ch) {
+        loop.copyFrom (ch, 0, region, ch, fade, length);
+
+        auto* tail = loop.getWritePointer (ch, length - fade);
+        const auto* lead = region.getReadPointer (ch);
+        for (int i = 0; i < fade; ++i) {
+            const auto w = (static_cast<float> (i) + 0.5f) / static_cast<float> (fade);
+            tail[i] += w * (lead[i] - tail[i]);
+        }
+    }
+
+    return loop;
+}
+
+void AudioEngine::copyLoop (const juce::AudioBuffer<float>& source, float* const* dest, int numChannels, juce::int64 position, int numSamples) noexcept
+{
+    const int length = source.getNumSamples();
+    if (length <= 0 || source.getNumChannels() <= 0) {
+        for (int ch = 0; ch < numChannels; ++ch)
+            juce::FloatVectorOperations::clear (dest[ch], numSamples);
+        return;
+    }
+
+    auto index = static_cast<int> (((position % length) + length) % length);
+    for (int done = 0; done < numSamples;) {
+        const int count = juce::jmin (numSamples - done, length - index);
+        for (int ch = 0; ch < numChannels; ++ch)
+            juce::FloatVectorOperations::copy (dest[ch] + done, source.getReadPointer (juce::jmin (ch, source.getNumChannels() - 1), index), count);
+        done += count;
+        index = 0;
+    }
+}
+
+void AudioEngine::readLoop (float* const* channels, int numChannels, int numSamples) noexcept
+{
+    const auto position = _loopRead.load();
+    copyLoop (_loop->original, channels, numChannels, position, numSamples);
+    recordDry (channels, numChannels, position, numSamples);
+    _loopRead = position + numSamples;
+}
+
 double AudioEngine::getPosition() const
 {
-    return _transportSource ? _transportSource->getCurrentPosition() : 0.0;
+    if (_transportSource == nullptr)
+        return 0.0;
+
+    if (_loop != nullptr) {
+        const auto offset = ((_loopRead.load() % _loop->length) + _loop->length) % _loop->length;
+        return static_cast<double> (_loop->start + offset) / _fileSampleRate;
+    }
+
+    // The transport may have run into the next item before the timer catches up
+    const auto position = _transportSource->getCurrentPosition() - static_cast<double> (_itemStart) / _fileSampleRate;
+    return juce::jlimit (0.0, getDuration(), position);
 }
 
 double AudioEngine::getDuration() const
 {
-    return _transportSource ? _transportSource->getLengthInSeconds() : 0.0;
+    return _fileSampleRate > 0.0 ? static_cast<double> (_itemLength) / _fileSampleRate : 0.0;
 }
 
 double AudioEngine::getSampleRate() const
@@ -250,9 +552,7 @@ double AudioEngine::getSampleRate() const
 
 int AudioEngine::getNumChannels() const
 {
-    if (_readerSource && _readerSource->getAudioFormatReader())
-        return static_cast<int> (_readerSource->getAudioFormatReader()->numChannels);
-    return 0;
+    return _playlist ? _playlist->numChannels() : 0;
 }
 
 void AudioEngine::audioDeviceIOCallbackWithContext (const float* const* inputChannelData,
@@ -264,6 +564,8 @@ void AudioEngine::audioDeviceIOCallbackWithContext (const float* const* inputCha
 {
     juce::ignoreUnused (inputChannelData, numInputChannels, context);
 
+    _threadPolicy.applyAudio();
+
     // If there are no output channels (e.g., user selected an input-only device), nothing to do.
     if (numOutputChannels <= 0 || outputChannelData == nullptr)
         return;
@@ -277,6 +579,20 @@ void AudioEngine::audioDeviceIOCallbackWithContext (const float* const* inputCha
     // Get audio from our mixer (thread-safe)
     juce::ScopedTryLock lock (_callbackLock);
     if (lock.isLocked() && _mixerSource) {
+        // Loop seeks take effect at the start of a block
+        if (_loop != nullptr) {
+            const auto jump = _loopJump.exchange (std::numeric_limits<juce::int64>::min());
+            if (jump != std::numeric_limits<juce::int64>::min())
+                _loopRead = jump;
+        }
+
+        // File position of this block, taken before the mixer pulls it
+        juce::int64 hqEnd = std::numeric_limits<juce::int64>::max();
+        const auto playhead = playheadInItem (hqEnd);
+        if (_preRenderer && playhead >= 0)
+            _preRenderer->setPlayhead (_loop != nullptr ? _loop->start + ((playhead % _loop->length) + _loop->length) % _loop->length
+                                                        : playhead);
+
         // Safety: Ensure at least one valid output channel exists
         bool hasValidChannel = false;
         for (int i = 0; i < numOutputChannels; ++i)
@@ -289,21 +605,32 @@ void AudioEngine::audioDeviceIOCallbackWithContext (const float* const* inputCha
 
         juce::AudioBuffer<float> buffer (outputChannelData, numOutputChannels, numSamples);
 
+        if (_liveInput.load()) {
+            processLive (inputChannelData, numInputChannels, buffer);
+            return;
+        }
+
+        // Nothing to process once stopped playback has rung out
+        if (_transportSource->isPlaying()) {
+            _idleSamples = 0;
+        } else if (_idleSamples < juce::roundToInt (_deviceSampleRate * detail::idleTailSeconds)) {
+            _idleSamples += numSamples;
+        } else {
+            _realtimeStale = true;
+            _sourceResamplerStale = true;
+            return;
+        }
+
         juce::AudioSourceChannelInfo channelInfo;
         channelInfo.buffer = &buffer;
         channelInfo.startSample = 0;
         channelInfo.numSamples = numSamples;
 
-        _mixerSource->getNextAudioBlock (channelInfo);
-
         // Process through ReTuner if enabled
-        if (_retunerProcessor) {
-            juce::MidiBuffer midiBuffer; // Empty MIDI buffer
-            if (_retunerProcessor->isSuspended())
-                _retunerProcessor->processBlockBypassed (buffer, midiBuffer);
-            else
-                _retunerProcessor->processBlock (buffer, midiBuffer);
-        }
+        if (_retunerProcessor)
+            processRetuner (buffer, playhead, hqEnd);
+        else
+            _mixerSource->getNextAudioBlock (channelInfo);
 
         // Notify position updates (occasionally, not every sample)
         static int positionUpdateCounter = 0;
@@ -321,57 +648,812 @@ void AudioEngine::audioDeviceIOCallbackWithContext (const float* const* inputCha
 
 void AudioEngine::audioDeviceAboutToStart (juce::AudioIODevice* device)
 {
-    if (device && _mixerSource) {
-        _mixerSource->prepareToPlay (device->getCurrentBufferSizeSamples(), device->getCurrentSampleRate());
-    }
+    if (device == nullptr)
+        return;
+
+    const juce::ScopedLock lock (_callbackLock);
+
+    _deviceSampleRate = device->getCurrentSampleRate();
+    _blockSize = device->getCurrentBufferSizeSamples();
 
     // Prepare ReTuner processor
-    if (_retunerProcessor && device) {
-        _retunerProcessor->prepareToPlay (device->getCurrentSampleRate(), device->getCurrentBufferSizeSamples());
+    if (_retunerProcessor)
+        _retunerProcessor->prepareToPlay (_deviceSampleRate, _blockSize);
+
+    _hqBuffer.setSize (2, _blockSize);
+    _hqMix = 0.0f;
+    _dryBuffer.setSize (2, _blockSize);
+    _abMix = _retunedAudible.load() ? 1.0f : 0.0f;
+
+    configureSources();
+
+    // The stretcher was reset, so pre-roll it to carry on where playback was.
+    // A loop plays from memory and can simply jump back.
+    if (isPlaying() && ! _liveInput.load()) {
+        if (_loop != nullptr)
+            seekWithPreroll (getPosition());
+        else
+            replayPreroll();
     }
 }
 
-void AudioEngine::audioDeviceStopped()
+void AudioEngine::replayPreroll()
 {
-    if (_mixerSource) {
-        _mixerSource->releaseResources();
+    // Pre-roll from the audio that was just played, replayed from the dry
+    // history ahead of the transport. Moving the transport back instead would
+    // throw away its read-ahead.
+    const auto position = _transportSource->getNextReadPosition();
+    const auto inputRate = _singlePassActive ? _fileSampleRate : _deviceSampleRate;
+    const auto wanted = static_cast<juce::int64> (_retunerProcessor->pitchPrerollLength() * _fileSampleRate / inputRate);
+    const auto available = _dryEnd == position ? juce::jmin (wanted, _dryEnd - _dryStart) : juce::int64 (0);
+
+    _replayPosition = position - available;
+    _replayEnd = position;
+    _seekPrerollSamples = static_cast<int> (available * inputRate / _fileSampleRate);
+    _seekPending = true;
+}
+
+void AudioEngine::configureSources()
+{
+    // The transport runs at the file rate. The rate is then converted either by
+    // the source resampler ahead of the pitch stage or, in single-pass mode, by
+    // the pitch stage itself.
+    const bool hasAudio = _playlist != nullptr && _playlist->getTotalLength() > 0;
+    _singlePassActive = _singlePass.load() && hasAudio && ! _liveInput.load()
+                        && ! juce::approximatelyEqual (_fileSampleRate, _deviceSampleRate);
+
+    // Attaching the playlist starts buffering from scratch, so keep what's
+    // buffered unless a larger read-ahead is wanted
+    const auto readAhead = hasAudio ? readAheadSize() : 0;
+    if (hasAudio && _transportSource != nullptr && (_readAheadSamples == 0 || readAhead > _readAheadSamples))
+        attachPlaylist (readAhead);
+
+    if (_retunerProcessor != nullptr)
+        _retunerProcessor->setResampleRatio (_singlePassActive ? _deviceSampleRate / _fileSampleRate : 1.0);
+
+    _realtimeStale = true;
+    _sourceResamplerStale = true;
+    _sourceRemainder = 0.0;
+
+    if (_blockSize <= 0)
+        return;
+
+    const auto sourceRate = hasAudio ? _fileSampleRate : _deviceSampleRate;
+    if (_mixerSource != nullptr)
+        _mixerSource->prepareToPlay (_blockSize, sourceRate);
+
+    // Scratch space for a block's worth of file rate audio plus the resampler's look-ahead
+    _sourceResampler.prepare (sourceRate, _deviceSampleRate, 2, _blockSize, detail::playbackResamplerQuality);
+    _hqResampler.prepare (sourceRate, _deviceSampleRate, 2, _blockSize, detail::playbackResamplerQuality);
+    _dryResampler.prepare (sourceRate, _deviceSampleRate, 2, _blockSize, detail::playbackResamplerQuality);
+    const int sourceLength = _sourceResampler.inputRequired (_blockSize) + _sourceResampler.numTaps() + 1;
+    _sourceBuffer.setSize (2, sourceLength);
+    _hqSource.setSize (2, sourceLength);
+    _drySource.setSize (2, sourceLength);
+    _hqPosition = -1.0e9;
+
+    // What was played stays in the history through a device restart, for replaying
+    const int historyLength = static_cast<int> (juce::nextPowerOfTwo (juce::roundToInt (sourceRate * detail::dryHistorySeconds)));
+    if (historyLength != _dryHistory.getNumSamples()) {
+        _dryHistory.setSize (2, historyLength);
+        _dryStart = _dryEnd = 0;
     }
+    _dryPosition = -1.0e9;
+}
 
-    // Release ReTuner processor resources
-    if (_retunerProcessor) {
-        _retunerProcessor->releaseResources();
+void AudioEngine::attachPlaylist (int readAhead)
+{
+    // Buffering starts over from the current position
+    const auto position = _transportSource->getNextReadPosition();
+    const bool playing = _transportSource->isPlaying();
+
+    _readAheadSamples = readAhead;
+    _transportSource->setSource (_playlist.get(),
+                                 _readAheadSamples, // Read-ahead buffer for smooth playback
+                                 &_audioFileThread, // Background thread for buffering
+                                 0.0,               // No resampling in the transport
+                                 2);                // Max channels
+    _readAheadPrimed = false;
+
+    _transportSource->setNextReadPosition (position);
+    if (playing)
+        _transportSource->start();
+}
+
+int AudioEngine::readAheadSize() const
+{
+    // A good number of device blocks, twice that for formats that decode in
+    // large frames, and enough to ride out the slowest recent read with margin
+    auto samples = static_cast<double> (juce::jmax (detail::minReadAhead, _blockSize * detail::readAheadBlocks));
+    if (_playlist->isCompressed())
+        samples *= 2.0;
+    samples = juce::jmax (samples, _playlist->slowestRead() * _fileSampleRate * detail::readAheadMargin);
+
+    const auto limit = juce::jmax (detail::minReadAhead, juce::roundToInt (_fileSampleRate * detail::maxReadAheadSeconds));
+    return juce::jmin (juce::nextPowerOfTwo (juce::roundToInt (samples)), juce::nextPowerOfTwo (limit));
+}
+
+void AudioEngine::updateReadAhead()
+{
+    if (! hasFileLoaded() || _liveInput.load())
+        return;
+
+    // Rebuffering drops out for a moment itself, so while playing only grow
+    // the buffer once it has actually run dry. Stopped, it can grow any time.
+    const auto underruns = _readAheadUnderruns.load();
+    const bool starved = underruns != _underrunsHandled;
+    _underrunsHandled = underruns;
+    if (readAheadSize() <= _readAheadSamples || (isPlaying() && ! starved))
+        return;
+
+    const juce::ScopedLock lock (_callbackLock);
+    configureSources();
+}
+
+void AudioEngine::countUnderrun (juce::int64 position, int numSamples) noexcept
+{
+    // Blocks right after a seek or a new source are empty until the read-ahead
+    // catches up, so only count running dry once it had been keeping up
+    if (position != _expectedReadPosition)
+        _readAheadPrimed = false;
+    _expectedReadPosition = position + numSamples;
+
+    const auto needed = juce::jmin (position + numSamples, _playlist->getTotalLength());
+    const bool buffered = _playlist->getNextReadPosition() >= needed;
+    if (! buffered && _readAheadPrimed)
+        ++_readAheadUnderruns;
+    _readAheadPrimed = buffered;
+}
+
+void AudioEngine::readSource (float* const* channels, int numChannels, int numSamples) noexcept
+{
+    const auto position = _transportSource->getNextReadPosition();
+    const bool playing = _transportSource->isPlaying();
+
+    // A loop plays from memory and leaves the transport where it is
+    if (_loop != nullptr && playing) {
+        readLoop (channels, numChannels, numSamples);
+        return;
+    }
+
+    // Replayed audio leads up to where the transport is; it was recorded when first played
+    if (_replayPosition < _replayEnd) {
+        const int numReplayed = static_cast<int> (juce::jmin<juce::int64> (numSamples, _replayEnd - _replayPosition));
+        juce::AudioBuffer<float> replayed (channels, numChannels, numReplayed);
+        if (playing && position == _replayEnd && copyDry (replayed, _replayPosition, numReplayed)) {
+            _replayPosition += numReplayed;
+            if (numReplayed < numSamples) {
+                juce::AudioBuffer<float> rest (channels, numChannels, numReplayed, numSamples - numReplayed);
+                readSource (rest.getArrayOfWritePointers(), numChannels, numSamples - numReplayed);
+            }
+            return;
+        }
+        _replayPosition = _replayEnd = 0;
+    }
+
+    if (playing)
+        countUnderrun (position, numSamples);
+
+    juce::AudioBuffer<float> input (channels, numChannels, numSamples);
+    juce::AudioSourceChannelInfo info (input);
+    _mixerSource->getNextAudioBlock (info);
+
+    if (playing)
+        recordDry (channels, numChannels, position, numSamples);
+}
+
+void AudioEngine::readSourceResampled (juce::AudioBuffer<float>& buffer) noexcept
+{
+    const int numSamples = buffer.getNumSamples();
+    if (_playlist->getTotalLength() <= 0 || juce::approximatelyEqual (_fileSampleRate, _deviceSampleRate)) {
+        readSource (buffer.getArrayOfWritePointers(), buffer.getNumChannels(), numSamples);
+        return;
+    }
+
+    // Start over after the transport was read some other way
+    if (_sourceResamplerStale) {
+        _sourceResampler.reset();
+        _sourceResamplerStale = false;
+    }
+
+    const int needed = _sourceResampler.inputRequired (numSamples);
+    if (needed > _sourceBuffer.getNumSamples())
+        return;
+
+    readSource (_sourceBuffer.getArrayOfWritePointers(), _sourceBuffer.getNumChannels(), needed);
+    _sourceResampler.process (_sourceBuffer.getArrayOfReadPointers(),
+                              buffer.getArrayOfWritePointers(),
+                              juce::jmin (buffer.getNumChannels(), _sourceBuffer.getNumChannels()),
+                              numSamples);
+}
+
+void AudioEngine::skipSource (int numSamples) noexcept
+{
+    // Keep the transport moving at the file rate while nothing needs its audio
+    _sourceRemainder += numSamples * (_fileSampleRate / _deviceSampleRate);
+    const int n = juce::jmin (static_cast<int> (_sourceRemainder), _sourceBuffer.getNumSamples());
+    _sourceRemainder -= n;
+    if (n > 0)
+        readSource (_sourceBuffer.getArrayOfWritePointers(), _sourceBuffer.getNumChannels(), n);
+    _sourceResamplerStale = true;
+}
+
+void AudioEngine::readPitchInput (juce::AudioBuffer<float>& input) noexcept
+{
+    // Single-pass mode feeds the stretcher at the file rate
+    if (_singlePassActive) {
+        readSource (input.getArrayOfWritePointers(), input.getNumChannels(), input.getNumSamples());
+        _sourceResamplerStale = true;
+    } else {
+        readSourceResampled (input);
+    }
+}
+
+juce::int64 AudioEngine::playheadInItem (juce::int64& hqEnd) const noexcept
+{
+    if (_transportSource == nullptr || ! _transportSource->isPlaying())
+        return -1;
+
+    // Loops play back pinned audio, addressed by how far the loop has been read
+    if (_loop != nullptr)
+        return _loopRead.load();
+
+    // Until the timer catches up with a new item, pre-rendered audio is still the previous one's
+    const auto location = _playlist->locate (_transportSource->getNextReadPosition());
+    if (location.item != _currentItem.load())
+        return -1;
+
+    // Hand the join between items to the realtime stretcher, which runs straight across it
+    if (! location.last)
+        hqEnd = location.length;
+
+    return location.offset;
+}
+
+void AudioEngine::processRetuner (juce::AudioBuffer<float>& buffer, juce::int64 playhead, juce::int64 hqEnd)
+{
+    juce::ScopedNoDenormals noDenormals;
+    const int numSamples = buffer.getNumSamples();
+
+    // After a seek, pre-roll the stretcher so it picks up at the new position
+    // without a start delay. Whatever comes before the start of the file is silence.
+    if (playhead >= 0 && _seekPending.exchange (false)) {
+        int silence = juce::jmax (0, _retunerProcessor->pitchPrerollLength() - _seekPrerollSamples.load());
+        _sourceResamplerStale = true;
+        _retunerProcessor->seekPitch ([this, &silence] (float* const* input, int numChannels, int numInput) {
+            const int zeros = juce::jmin (silence, numInput);
+            for (int ch = 0; ch < numChannels; ++ch)
+                juce::FloatVectorOperations::clear (input[ch], zeros);
+            silence -= zeros;
+
+            if (zeros < numInput) {
+                juce::AudioBuffer<float> view (input, numChannels, zeros, numInput - zeros);
+                readPitchInput (view);
+            }
+        });
+
+        _realtimeStale = false;
+        _realtimeRunSamples = _retunerProcessor->pitchLatency() + detail::hqFadeSamples;
+
+        // The pre-roll moved the transport up to the new position
+        playhead = playheadInItem (hqEnd);
+    }
+
+    // Stream position of this block, before the stretcher pulls any more input
+    const auto streamPosition = ! _transportSource->isPlaying() ? juce::int64 (-1)
+                                : _loop != nullptr            ? _loopRead.load()
+                                                              : _transportSource->getNextReadPosition();
+
+    const double ratio = _fileSampleRate / _deviceSampleRate;
+
+    // Pre-rendered audio is read as far behind the playhead as the realtime
+    // stretcher's latency, so the two line up when cross-fading between them
+    const int latency = _retunerProcessor->pitchLatency();
+    const auto hqStart = playhead - static_cast<juce::int64> (latency * ratio);
+    const int hqLength = static_cast<int> (std::ceil (numSamples * ratio)) + _hqResampler.numTaps();
+    const int warmup = juce::roundToInt (_fileSampleRate * detail::hqWarmupSeconds);
+
+    const bool hqNow = (_hqPreview.load() || _loop != nullptr) && playhead >= 0 && _preRenderer != nullptr
+                       && readPreRendered (hqStart, numSamples);
+    // Audio rendered at a stale pitch only plays until the stretcher takes over
+    const auto renderedRatio = _loop != nullptr ? _loop->retunedRatio : _preRenderer->pitchRatio();
+    const bool hqCurrent = hqNow && juce::approximatelyEqual (renderedRatio, _retunerProcessor->pitchRatio());
+    // A pinned loop is rendered all the way round
+    const bool hqSoon = hqNow && hqCurrent
+                        && (_loop != nullptr
+                            || (_preRenderer->isRendered (hqStart, hqLength + warmup) && hqStart + hqLength + warmup <= hqEnd));
+    const bool realtimeWarm = ! _realtimeStale && _realtimeRunSamples >= latency + detail::hqFadeSamples;
+
+    // Hand over to the realtime stretcher only once it has warmed up
+    const float target = hqNow && (hqSoon || ! realtimeWarm) ? 1.0f : 0.0f;
+
+    // Nothing worth fading from while the stretcher is cold
+    if (target >= 1.0f && ! realtimeWarm)
+        _hqMix = 1.0f;
+
+    // Keep the stretcher running whenever it may be needed soon
+    if (! hqSoon || _hqMix < 1.0f) {
+        if (_realtimeStale) {
+            _retunerProcessor->resetPitch();
+            _realtimeStale = false;
+            _realtimeRunSamples = 0;
+        }
+
+        // The stretcher pulls input as it needs it
+        _retunerProcessor->processPitch (buffer, [this] (float* const* input, int numChannels, int numInput) {
+            juce::AudioBuffer<float> view (input, numChannels, numInput);
+            readPitchInput (view);
+        });
+        _realtimeRunSamples = juce::jmin (_realtimeRunSamples + numSamples, std::numeric_limits<int>::max() / 2);
+    } else {
+        // Playing pre-rendered audio only; the stretcher restarts when it's needed again
+        _realtimeStale = true;
+        skipSource (numSamples);
     }
+
+    if (hqNow)
+        mixPreRendered (buffer, target);
+    else
+        _hqMix = 0.0f;
+
+    // The original audio is delayed by the same amount as the retuned audio
+    mixDry (buffer, streamPosition >= 0 ? streamPosition - static_cast<juce::int64> (latency * ratio) : -1);
+
+    _retunerProcessor->processGain (buffer);
+}
+
+bool AudioEngine::readPreRendered (juce::int64 startSample, int numSamples)
+{
+    if (numSamples > _hqBuffer.getNumSamples())
+        return false;
+
+    const double ratio = _fileSampleRate / _deviceSampleRate;
+    if (juce::approximatelyEqual (ratio, 1.0)) {
+        if (! readRendered (_hqBuffer, startSample, numSamples))
+            return false;
+        _hqReadPosition = startSample + numSamples;
+        return true;
+    }
+
+    // Resynchronise after seeks or latency changes, otherwise keep reading on
+    // from where the resampler left off. Its look-ahead means the input read so
+    // far runs ahead of the position of the next output sample.
+    if (std::abs (static_cast<double> (startSample) - _hqPosition) > numSamples * ratio + 1.0) {
+        _hqResampler.reset();
+        _hqReadPosition = startSample;
+        _hqPosition = static_cast<double> (startSample);
+    }
+
+    const int needed = _hqResampler.inputRequired (numSamples);
+    juce::AudioBuffer<float> input (_hqSource.getArrayOfWritePointers(), _hqSource.getNumChannels(), juce::jmax (0, needed));
+    if (needed > _hqSource.getNumSamples() || ! readRendered (input, _hqReadPosition, needed))
+        return false;
+
+    _hqResampler.process (_hqSource.getArrayOfReadPointers(), _hqBuffer.getArrayOfWritePointers(), _hqBuffer.getNumChannels(), numSamples);
+    _hqReadPosition += needed;
+    _hqPosition += numSamples * ratio;
+
+    return true;
+}
+
+bool AudioEngine::readRendered (juce::AudioBuffer<float>& dest, juce::int64 startSample, int numSamples) const noexcept
+{
+    if (_loop == nullptr)
+        return _preRenderer->read (dest, 0, startSample, numSamples);
+
+    // Pinned loop audio, wrapping round at the loop end
+    if (_loop->retuned.getNumSamples() == 0)
+        return false;
+
+    copyLoop (_loop->retuned, dest.getArrayOfWritePointers(), dest.getNumChannels(), startSample, numSamples);
+    return true;
+}
+
+void AudioEngine::mixPreRendered (juce::AudioBuffer<float>& buffer, float target)
+{
+    const int numSamples = buffer.getNumSamples();
+    const int numChannels = juce::jmin (buffer.getNumChannels(), _hqBuffer.getNumChannels());
+    const float step = 1.0f / static_cast<float> (detail::hqFadeSamples);
+
+    float mix = _hqMix;
+    for (int ch = 0; ch < numChannels; ++ch) {
+        auto* out = buffer.getWritePointer (ch);
+        const auto* hq = _hqBuffer.getReadPointer (ch);
+
+        mix = _hqMix;
+        if (juce::approximatelyEqual (mix, target)) {
+            if (target >= 1.0f)
+                juce::FloatVectorOperations::copy (out, hq, numSamples);
+            continue;
+        }
+
+        for (int i = 0; i < numSamples; ++i) {
+            mix = target > mix ? juce::jmin (target, mix + step) : juce::jmax (target, mix - step);
+            out[i] += mix * (hq[i] - out[i]);
+        }
+    }
+
+    _hqMix = mix;
+}
+
+void AudioEngine::recordDry (const float* const* channels, int numChannels, juce::int64 position, int numSamples) noexcept
+{
+    const int size = _dryHistory.getNumSamples();
+    if (size <= 0 || numChannels <= 0)
+        return;
+
+    // Start over after a seek
+    if (position != _dryEnd)
+        _dryStart = _dryEnd = position;
+
+    for (int done = 0; done < numSamples;) {
+        const int index = static_cast<int> ((position + done) & (size - 1));
+        const int count = juce::jmin (numSamples - done, size - index);
+        for (int ch = 0; ch < _dryHistory.getNumChannels(); ++ch)
+            _dryHistory.copyFrom (ch, index, channels[juce::jmin (ch, numChannels - 1)] + done, count);
+        done += count;
+    }
+
+    _dryEnd = position + numSamples;
+    _dryStart = juce::jmax (_dryStart, _dryEnd - size);
+}
+
+bool AudioEngine::copyDry (juce::AudioBuffer<float>& dest, juce::int64 startSample, int numSamples) const noexcept
+{
+    if (startSample < _dryStart || startSample + numSamples > _dryEnd)
+        return false;
+
+    const int size = _dryHistory.getNumSamples();
+    for (int done = 0; done < numSamples;) {
+        const int index = static_cast<int> ((startSample + done) & (size - 1));
+        const int count = juce::jmin (numSamples - done, size - index);
+        for (int ch = 0; ch < dest.getNumChannels(); ++ch)
+            dest.copyFrom (ch, done, _dryHistory, juce::jmin (ch, _dryHistory.getNumChannels() - 1), index, count);
+        done += count;
+    }
+
+    return true;
+}
+
+bool AudioEngine::readDry (juce::int64 startSample, int numSamples) noexcept
+{
+    if (numSamples > _dryBuffer.getNumSamples())
+        return false;
+
+    const double ratio = _fileSampleRate / _deviceSampleRate;
+    if (juce::approximatelyEqual (ratio, 1.0))
+        return copyDry (_dryBuffer, startSample, numSamples);
+
+    // Same bookkeeping as readPreRendered()
+    if (std::abs (static_cast<double> (startSample) - _dryPosition) > numSamples * ratio + 1.0) {
+        _dryResampler.reset();
+        _dryReadPosition = startSample;
+        _dryPosition = static_cast<double> (startSample);
+    }
+
+    const int needed = _dryResampler.inputRequired (numSamples);
+    if (needed > _drySource.getNumSamples())
+        return false;
+
+    juce::AudioBuffer<float> input (_drySource.getArrayOfWritePointers(), _drySource.getNumChannels(), needed);
+    if (! copyDry (input, _dryReadPosition, needed))
+        return false;
+
+    _dryResampler.process (_drySource.getArrayOfReadPointers(), _dryBuffer.getArrayOfWritePointers(), _dryBuffer.getNumChannels(), numSamples);
+    _dryReadPosition += needed;
+    _dryPosition += numSamples * ratio;
+
+    return true;
+}
+
+void AudioEngine::mixDry (juce::AudioBuffer<float>& buffer, juce::int64 startSample) noexcept
+{
+    const float target = _retunedAudible.load() ? 1.0f : 0.0f;
+    const int numSamples = buffer.getNumSamples();
+
+    // Nothing extra to do while only the retuned audio is heard
+    if ((_abMix >= 1.0f && target >= 1.0f) || numSamples > _dryBuffer.getNumSamples())
+        return;
+
+    if (startSample < 0 || ! readDry (startSample, numSamples))
+        _dryBuffer.clear (0, numSamples);
+
+    fadeDry (buffer);
+}
+
+void AudioEngine::fadeDry (juce::AudioBuffer<float>& buffer) noexcept
+{
+    // Cross-fades between the buffer and the original audio in the dry buffer
+    const float target = _retunedAudible.load() ? 1.0f : 0.0f;
+    const int numSamples = buffer.getNumSamples();
+    const int numChannels = juce::jmin (buffer.getNumChannels(), _dryBuffer.getNumChannels());
+    const float step = 1.0f / static_cast<float> (detail::abFadeSamples);
+
+    float mix = _abMix;
+    for (int ch = 0; ch < numChannels; ++ch) {
+        auto* out = buffer.getWritePointer (ch);
+        const auto* dry = _dryBuffer.getReadPointer (ch);
+
+        mix = _abMix;
+        if (mix <= 0.0f && target <= 0.0f) {
+            juce::FloatVectorOperations::copy (out, dry, numSamples);
+            continue;
+        }
+
+        for (int i = 0; i < numSamples; ++i) {
+            mix = target > mix ? juce::jmin (target, mix + step) : juce::jmax (target, mix - step);
+            out[i] = dry[i] + mix * (out[i] - dry[i]);
+        }
+    }
+
+    _abMix = mix;
+}
+
+void AudioEngine::audioDeviceStopped()
+{
+    // Sources and the stretcher are kept as they are. A device change starts
+    // the new device straight after, and audioDeviceAboutToStart() carries on
+    // with what's buffered rather than building everything again.
+    _blockSize = 0;
 }
 
 void AudioEngine::changeListenerCallback (juce::ChangeBroadcaster* source)
 {
     if (source == &_deviceManager) {
-        // Audio device changed - we might need to update sample rates etc.
-        // For now, just restart playback if something was playing
-        if (isPlaying()) {
-            stop();
-            // Could automatically restart playback here if desired
+        // A device opened from the preferences ends a suspension too
+        if (_deviceManager.getCurrentAudioDevice() != nullptr)
+            _deviceSuspended = false;
+
+        // Device changes made by the engine carry on playing from where they were
+        if (_reconfiguringDevice) {
+            _reconfiguringDevice = false;
+            return;
         }
 
+        // Playback carries on: audioDeviceAboutToStart() has already prepared
+        // for the new device and picked up from the same position.
+
+        // A device picked by the user replaces the rate to return to
+        _userSampleRate = 0.0;
+
         // Persist new device settings
-        if (auto state = _deviceManager.createStateXml()) {
-            auto& settings = Application::settingsRef();
-            settings.setAudioDeviceStateXML (state.get());
-            settings.flush();
+        saveDeviceState();
+    }
+}
+
+void AudioEngine::switchDeviceSampleRate (double sampleRate)
+{
+    auto* device = _deviceManager.getCurrentAudioDevice();
+    if (device == nullptr || juce::approximatelyEqual (device->getCurrentSampleRate(), sampleRate))
+        return;
+
+    const auto rates = device->getAvailableSampleRates();
+    if (! std::any_of (rates.begin(), rates.end(), [sampleRate] (double r) { return juce::approximatelyEqual (r, sampleRate); }))
+        return;
+
+    auto setup = _deviceManager.getAudioDeviceSetup();
+    const auto previousRate = setup.sampleRate;
+    setup.sampleRate = sampleRate;
+
+    // The device restarts with the new rate and configureSources() picks up
+    // playback where it left off
+    _reconfiguringDevice = true;
+    const auto error = _deviceManager.setAudioDeviceSetup (setup, true);
+    if (error.isNotEmpty()) {
+        _reconfiguringDevice = false;
+        notifyError ("Unable to change the device sample rate: " + error);
+        return;
+    }
+
+    if (_userSampleRate <= 0.0)
+        _userSampleRate = previousRate;
+}
+
+void AudioEngine::setLiveInput (bool enabled)
+{
+    if (enabled == _liveInput.load())
+        return;
+
+    auto& settings = Application::settingsRef();
+    settings.setLiveInput (enabled);
+    settings.flush();
+
+    // Playback gives way to the input, on a device woken up if it was idle
+    if (enabled) {
+        pause();
+        resumeDevice();
+    }
+
+    _liveInput = enabled;
+    _retunerProcessor->setLowLatency (enabled);
+    configureLiveDevice (enabled);
+}
+
+void AudioEngine::configureLiveDevice (bool enabled)
+{
+    auto setup = _deviceManager.getAudioDeviceSetup();
+    auto* device = _deviceManager.getCurrentAudioDevice();
+
+    if (enabled) {
+        setup.useDefaultInputChannels = true;
+
+        // The smallest buffer the device offers from 64 samples up
+        int best = 0;
+        if (device != nullptr)
+            for (auto size : device->getAvailableBufferSizes())
+                if (size >= detail::liveBufferSize && (best == 0 || size < best))
+                    best = size;
+
+        if (best > 0 && best != setup.bufferSize) {
+            if (_userBufferSize <= 0)
+                _userBufferSize = setup.bufferSize;
+            setup.bufferSize = best;
+        }
+    } else {
+        setup.useDefaultInputChannels = false;
+        setup.inputChannels.clear();
+        if (_userBufferSize > 0) {
+            setup.bufferSize = _userBufferSize;
+            _userBufferSize = 0;
         }
     }
+
+    if (setup != _deviceManager.getAudioDeviceSetup()) {
+        _reconfiguringDevice = true;
+        const auto error = _deviceManager.setAudioDeviceSetup (setup, true);
+        if (error.isNotEmpty()) {
+            _reconfiguringDevice = false;
+            notifyError ("Unable to configure the audio device for live input: " + error);
+        }
+    }
+
+    // The stretcher picks up its new window when prepared again, whether or not the device restarted
+    const juce::ScopedLock lock (_callbackLock);
+    if (_blockSize > 0)
+        _retunerProcessor->prepareToPlay (_deviceSampleRate, _blockSize);
+    configureSources();
 }
 
-void AudioEngine::enableReTuner (bool enabled)
+void AudioEngine::processLive (const float* const* input, int numInputChannels, juce::AudioBuffer<float>& buffer) noexcept
 {
-    if (_retunerProcessor) {
-        _retunerProcessor->suspendProcessing (! enabled);
+    const int numSamples = buffer.getNumSamples();
+
+    // Mono inputs feed every output
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch) {
+        const auto* source = input != nullptr && numInputChannels > 0 ? input[juce::jmin (ch, numInputChannels - 1)] : nullptr;
+        if (source != nullptr)
+            buffer.copyFrom (ch, 0, source, numSamples);
+        else
+            buffer.clear (ch, 0, numSamples);
+    }
+
+    if (_retunerProcessor == nullptr)
+        return;
+
+    // Keep the input as it came in for the A/B switch. It isn't delayed to line
+    // up with the retuned signal, which would add the stretcher's latency to it.
+    const bool keepDry = (_abMix < 1.0f || ! _retunedAudible.load()) && numSamples <= _dryBuffer.getNumSamples();
+    if (keepDry)
+        for (int ch = 0; ch < _dryBuffer.getNumChannels(); ++ch)
+            _dryBuffer.copyFrom (ch, 0, buffer, juce::jmin (ch, buffer.getNumChannels() - 1), 0, numSamples);
+
+    juce::ScopedNoDenormals noDenormals;
+    _retunerProcessor->processPitch (buffer);
+    if (keepDry)
+        fadeDry (buffer);
+    _retunerProcessor->processGain (buffer);
+    _liveLatencySamples = _retunerProcessor->pitchLatency();
+}
+
+double AudioEngine::estimatedLiveLatency() const
+{
+    auto* device = _deviceManager.getCurrentAudioDevice();
+    if (device == nullptr || device->getCurrentSampleRate() <= 0.0)
+        return 0.0;
+
+    const auto samples = device->getInputLatencyInSamples() + device->getOutputLatencyInSamples()
+                         + device->getCurrentBufferSizeSamples() + _liveLatencySamples.load();
+    return samples / device->getCurrentSampleRate();
+}
+
+void AudioEngine::setMatchDeviceSampleRate (bool enabled)
+{
+    _matchSampleRate = enabled;
+
+    auto& settings = Application::settingsRef();
+    settings.setMatchDeviceSampleRate (enabled);
+    settings.flush();
+
+    if (enabled && hasFileLoaded()) {
+        switchDeviceSampleRate (_fileSampleRate);
+    } else if (! enabled && _userSampleRate > 0.0) {
+        switchDeviceSampleRate (_userSampleRate);
+        _userSampleRate = 0.0;
+    }
+}
+
+void AudioEngine::setIdleTimeout (int seconds)
+{
+    _idleTimeout = juce::jmax (0, seconds);
+    _idleSince = juce::Time::getMillisecondCounterHiRes();
+
+    auto& settings = Application::settingsRef();
+    settings.setIdleTimeout (_idleTimeout);
+    settings.flush();
+}
+
+void AudioEngine::updateIdle()
+{
+    const auto now = juce::Time::getMillisecondCounterHiRes();
+    if (isPlaying() || _liveInput.load() || _deviceSuspended || _idleTimeout <= 0) {
+        _idleSince = now;
+        return;
+    }
+
+    if (now - _idleSince >= _idleTimeout * 1000.0)
+        suspendDevice();
+}
+
+void AudioEngine::suspendDevice()
+{
+    if (_deviceManager.getCurrentAudioDevice() == nullptr)
+        return;
+
+    // Closing reports a change that isn't the user's either
+    _deviceSuspended = true;
+    _reconfiguringDevice = true;
+    _deviceManager.closeAudioDevice();
+
+    // Take the transport off the read-ahead thread as well. Buffering starts
+    // again when the device does.
+    const juce::ScopedLock lock (_callbackLock);
+    if (_mixerSource != nullptr)
+        _mixerSource->releaseResources();
+}
+
+void AudioEngine::resumeDevice()
+{
+    if (! _deviceSuspended)
+        return;
+
+    _deviceSuspended = false;
+    _idleSince = juce::Time::getMillisecondCounterHiRes();
+    _deviceManager.restartLastAudioDevice();
+
+    if (_deviceManager.getCurrentAudioDevice() == nullptr) {
+        notifyError ("Unable to reopen the audio device");
+        return;
     }
+
+    // Reopening goes through setAudioDeviceSetup(), which reports a change
+    // that isn't the user's
+    _reconfiguringDevice = true;
+}
+
+void AudioEngine::saveDeviceState()
+{
+    auto state = _deviceManager.createStateXml();
+    if (state == nullptr)
+        return;
+
+    // Remember the rate the user chose rather than one matched to a file
+    if (_userSampleRate > 0.0)
+        state->setAttribute ("audioDeviceRate", _userSampleRate);
+
+    auto& settings = Application::settingsRef();
+    settings.setAudioDeviceStateXML (state.get());
+    settings.flush();
+}
+
+void AudioEngine::enableReTuner (bool enabled)
+{
+    // The stretcher keeps running either way, so switching back is instant
+    _retunedAudible = enabled;
 }
 
 bool AudioEngine::isReTunerEnabled() const
 {
-    return _retunerProcessor != nullptr && ! _retunerProcessor->isSuspended();
+    return _retunerProcessor != nullptr && _retunedAudible.load();
 }
 
 void AudioEngine::setSourceFrequency (float frequency)
@@ -408,6 +1490,140 @@ float AudioEngine::targetFrequency() const noexcept
     return 432.f;
 }
 
+void AudioEngine::setHighQualityPreview (bool enabled)
+{
+    _hqPreview = enabled;
+
+    auto& settings = Application::settingsRef();
+    settings.setHighQualityPreview (enabled);
+    settings.flush();
+
+    if (enabled) {
+        restartPreRender();
+    } else if (_preRenderer && _loop == nullptr) {
+        _preRenderer->stop();
+        _preRenderer->cache().clear();
+    }
+}
+
+void AudioEngine::setSinglePassResampling (bool enabled)
+{
+    _singlePass = enabled;
+
+    auto& settings = Application::settingsRef();
+    settings.setSinglePassResampling (enabled);
+    settings.flush();
+
+    const juce::ScopedLock lock (_callbackLock);
+    configureSources();
+}
+
+double AudioEngine::preRenderProgress() const
+{
+    return _preRenderer ? _preRenderer->progress() : 0.0;
+}
+
+void AudioEngine::restartPreRender()
+{
+    if (_preRenderer && _retunerProcessor && hasFileLoaded())
+        _preRenderer->start (_currentFile, _retunerProcessor->pitchRatio());
+}
+
+void AudioEngine::updatePlaylist()
+{
+    if (_transportSource == nullptr || ! hasFileLoaded())
+        return;
+
+    // Follow playback into the next item
+    const auto location = _playlist->locate (_transportSource->getNextReadPosition());
+    if (location.item > _currentItem.load())
+        advanceTo (location.item);
+
+    if (_queue.isEmpty() || _playlist->numItems() > _currentItem.load() + 1)
+        return;
+
+    // Join the next file onto the stream well before the current one ends. One
+    // that can't be joined starts once the current file has finished instead.
+    if (! _preloadAttempted) {
+        preloadNext();
+    } else if (_transportSource->hasStreamFinished()) {
+        if (loadAudioFile (_queue.removeAndReturn (0)))
+            play();
+    }
+}
+
+void AudioEngine::preloadNext()
+{
+    _preloadAttempted = true;
+
+    const auto file = _queue.getFirst();
+    auto reader = createReaderFor (file);
+    if (reader == nullptr) {
+        notifyError ("Unable to load audio file: " + file.getFileName());
+        _queue.remove (0);
+        _preloadAttempted = false;
+        return;
+    }
+
+    // Only files at the playing file's sample rate can share its stream
+    const auto preload = juce::roundToInt (reader->sampleRate * detail::preloadSeconds);
+    if (! _playlist->append (std::move (reader), file, preload))
+        return;
+
+    // A short item can be buffered to its end before the next one is joined,
+    // leaving silence in the read-ahead where the new item goes
+    if (_playlist->hasReadPastEnd()) {
+        const juce::ScopedLock lock (_callbackLock);
+        attachPlaylist (_readAheadSamples);
+    }
+}
+
+void AudioEngine::advanceTo (int item)
+{
+    _currentItem = item;
+    _itemStart = _playlist->itemStart (item);
+    _itemLength = _playlist->itemLength (item);
+    _playlist->release (item);
+
+    _currentFile = _playlist->file (item);
+    _currentFileName = _currentFile.getFileName();
+    _preloadAttempted = false;
+    if (! _queue.isEmpty() && _queue.getFirst() == _currentFile)
+        _queue.remove (0);
+
+    if (_hqPreview.load())
+        restartPreRender();
+
+    notifyFileLoaded (_currentFile);
+}
+
+void AudioEngine::timerCallback()
+{
+    updatePlaylist();
+    updateLoop();
+    updateReadAhead();
+    updateIdle();
+
+    _threadPolicy.setPlaybackActive (isPlaying() || _liveInput.load());
+    for (const auto& problem : _threadPolicy.takeNewProblems())
+        juce::Logger::writeToLog ("Thread policy: " + problem);
+
+    if ((! _hqPreview.load() && _loop == nullptr) || _preRenderer == nullptr || _retunerProcessor == nullptr || ! hasFileLoaded())
+        return;
+
+    // Wait for the pitch ratio to settle before rendering it
+    const auto ratio = _retunerProcessor->pitchRatio();
+    if (! juce::approximatelyEqual (ratio, _pendingPitchRatio)) {
+        _pendingPitchRatio = ratio;
+        return;
+    }
+
+    if (_preRenderer->file() != _currentFile)
+        restartPreRender();
+    else if (! juce::approximatelyEqual (ratio, _preRenderer->pitchRatio()))
+        _preRenderer->retune (ratio);
+}
+
 void AudioEngine::notifyError (const juce::String& message)
 {
     if (onErrorOccurred) {
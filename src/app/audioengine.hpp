@@ -7,6 +7,11 @@
 #include <juce_audio_formats/juce_audio_formats.h>
 #include <juce_audio_utils/juce_audio_utils.h>
 #include "../processor.hpp"
+#include "../resampler.hpp"
+#include "mp3seekindex.hpp"
+#include "playlistsource.hpp"
+#include "prerenderer.hpp"
+#include "threadpolicy.hpp"
 
 namespace retuner {
 namespace app {
@@ -16,7 +21,8 @@ namespace app {
  * Handles audio device management, file loading, and playback.
  */
 class AudioEngine : public juce::AudioIODeviceCallback,
-                    public juce::ChangeListener {
+                    public juce::ChangeListener,
+                    private juce::Timer {
 public:
     AudioEngine();
     ~AudioEngine() override;
@@ -51,7 +57,19 @@ public:
     bool hasFileLoaded() const;
     void restoreLastLoadedFile();
 
-    // ReTuner DSP control
+    // Playlist: queued files follow the current one without a gap
+    void enqueue (const juce::File& file);
+    void clearQueue();
+    juce::Array<juce::File> queue() const { return _queue; }
+
+    // Loop region within the current file, in seconds. The region's original and
+    // retuned audio are pinned in memory so repeats don't decode or stretch again.
+    bool setLoopRegion (double startSeconds, double endSeconds);
+    void clearLoopRegion();
+    juce::Range<double> loopRegion() const;
+
+    // ReTuner DSP control. Disabling it switches to the original audio, delayed
+    // to line up with the retuned audio, so toggling gives a seamless A/B compare.
     void enableReTuner (bool enabled);
     bool isReTunerEnabled() const;
 
@@ -63,8 +81,45 @@ public:
 
     retuner::Processor* processor() const { return _retunerProcessor.get(); }
 
+    // High-quality preview: plays audio pre-rendered by the offline pipeline where available
+    void setHighQualityPreview (bool enabled);
+    bool isHighQualityPreviewEnabled() const noexcept { return _hqPreview.load(); }
+    double preRenderProgress() const;
+
+    // Single-pass resampling: the pitch stage also converts the file rate to the device rate
+    void setSinglePassResampling (bool enabled);
+    bool isSinglePassResamplingEnabled() const noexcept { return _singlePass.load(); }
+
+    // Switch the device to the loaded file's sample rate when the device supports it
+    void setMatchDeviceSampleRate (bool enabled);
+    bool isMatchDeviceSampleRateEnabled() const noexcept { return _matchSampleRate; }
+
+    // Live input: retune the device input with the lowest latency stretcher instead of playing files
+    void setLiveInput (bool enabled);
+    bool isLiveInputEnabled() const noexcept { return _liveInput.load(); }
+
+    /** Estimated round trip latency of live input in seconds: what the driver
+        reports for input and output, one buffer, and the stretcher's latency.
+        Nothing is measured, so converters and drivers that under-report aren't counted. */
+    double estimatedLiveLatency() const;
+
+    // Idle power saving: processing stops once stopped playback has rung out, and
+    // after the timeout the device is closed until the next play(). 0 never closes it.
+    void setIdleTimeout (int seconds);
+    int idleTimeout() const noexcept { return _idleTimeout; }
+    bool isDeviceSuspended() const noexcept { return _deviceSuspended; }
+
+    // Read-ahead: sized from the device block size, the file format and how long
+    // reads have been taking, and grown when playback runs dry
+    int readAheadSamples() const noexcept { return _readAheadSamples; }
+    int readAheadUnderruns() const noexcept { return _readAheadUnderruns.load(); }
+    int deviceUnderruns() const { return _deviceManager.getXRunCount(); }
+
     juce::AudioFormatManager& formatManager() noexcept { return _formatManager; }
 
+    // Scheduling policy for the audio callback and background threads, exports included
+    ThreadPolicy& threadPolicy() noexcept { return _threadPolicy; }
+
     // Callbacks for UI updates
     std::function<void (double)> onPositionChanged;
     std::function<void (bool)> onPlaybackStateChanged;
@@ -86,19 +141,111 @@ public:
     void changeListenerCallback (juce::ChangeBroadcaster* source) override;
 
 private:
-    // Core audio components
+    // Core audio components. The thread policy outlives the threads it's applied to.
+    ThreadPolicy _threadPolicy;
     juce::AudioDeviceManager _deviceManager;
     juce::AudioFormatManager _formatManager;
     juce::TimeSliceThread _audioFileThread;
 
-    // Audio file playback
-    std::unique_ptr<juce::AudioFormatReaderSource> _readerSource;
+    // Audio file playback. Positions reported to the UI are within the current item.
+    std::unique_ptr<PlaylistSource> _playlist;
     std::unique_ptr<juce::AudioTransportSource> _transportSource;
     std::unique_ptr<juce::MixerAudioSource> _mixerSource;
 
     // ReTuner DSP processor
     std::unique_ptr<retuner::Processor> _retunerProcessor;
 
+    // Frame indexes for seeking in MP3s
+    std::unique_ptr<Mp3SeekIndexCache> _seekIndex;
+
+    // High-quality preview
+    std::unique_ptr<PreRenderer> _preRenderer;
+    std::atomic<bool> _hqPreview { true };
+    float _pendingPitchRatio { 1.0f };
+
+    // High-quality preview state (audio thread)
+    double _deviceSampleRate { 44100.0 };
+    double _fileSampleRate { 44100.0 };
+    juce::AudioBuffer<float> _hqBuffer;
+    juce::AudioBuffer<float> _hqSource;
+    retuner::dsp::Resampler _hqResampler;
+    juce::int64 _hqReadPosition { 0 };
+    double _hqPosition { 0.0 };
+    float _hqMix { 0.0f };
+    bool _realtimeStale { true };
+    int _realtimeRunSamples { 0 };
+
+    // Pinned loop audio. Swapped under the callback lock on the message thread.
+    struct Loop {
+        juce::int64 start { 0 };            // position in the current item
+        juce::int64 length { 0 };
+        int fade { 0 };                     // wrap cross-fade length
+        juce::AudioBuffer<float> original;  // file rate, tail faded into the head
+        juce::AudioBuffer<float> retuned;   // likewise, empty until rendered
+        float retunedRatio { 0.0f };
+    };
+    std::unique_ptr<Loop> _loop;
+    std::atomic<juce::int64> _loopRead { 0 };  // audio thread: samples read since the loop start, unwrapped
+    std::atomic<juce::int64> _loopJump { std::numeric_limits<juce::int64>::min() };
+
+    // Original audio for A/B compares: everything read from the transport, kept
+    // long enough to be played back in line with the retuned audio
+    std::atomic<bool> _retunedAudible { true };
+    float _abMix { 1.0f };
+    juce::AudioBuffer<float> _dryHistory;
+    juce::int64 _dryStart { 0 };
+    juce::int64 _dryEnd { 0 };
+    juce::AudioBuffer<float> _dryBuffer;
+    juce::AudioBuffer<float> _drySource;
+    retuner::dsp::Resampler _dryResampler;
+    juce::int64 _dryReadPosition { 0 };
+    double _dryPosition { 0.0 };
+
+    // Seeks pre-roll the stretcher from the audio leading up to the new position
+    std::atomic<bool> _seekPending { false };
+    std::atomic<int> _seekPrerollSamples { 0 };
+    juce::int64 _replayPosition { 0 }; // after a device restart, played audio replayed up to
+    juce::int64 _replayEnd { 0 };      // the transport position; guarded by the callback lock
+
+    // File rate to device rate conversion. The transport always runs at the file rate.
+    std::atomic<bool> _singlePass { false };
+    bool _singlePassActive { false }; // guarded by the callback lock
+    int _blockSize { 0 };
+    juce::AudioBuffer<float> _sourceBuffer;
+    retuner::dsp::Resampler _sourceResampler;
+    bool _sourceResamplerStale { true };
+    double _sourceRemainder { 0.0 };
+
+    // Device sample rate matching (message thread)
+    bool _matchSampleRate { false };
+    double _userSampleRate { 0.0 }; // rate to return to, 0 when the device wasn't switched
+    bool _reconfiguringDevice { false }; // set while the engine itself changes the device setup
+
+    // Live input
+    std::atomic<bool> _liveInput { false };
+    std::atomic<int> _liveLatencySamples { 0 };
+    int _userBufferSize { 0 }; // buffer size to return to, 0 when unchanged
+
+    // Idle power saving
+    int _idleTimeout { 0 };            // seconds, 0 for never
+    bool _deviceSuspended { false };   // message thread
+    double _idleSince { 0.0 };         // message thread, milliseconds
+    int _idleSamples { 0 };            // audio thread: output samples since playback stopped
+
+    // Read-ahead sizing and underrun tracking
+    int _readAheadSamples { 0 };              // guarded by the callback lock
+    std::atomic<int> _readAheadUnderruns { 0 };
+    int _underrunsHandled { 0 };              // message thread
+    juce::int64 _expectedReadPosition { -1 }; // audio thread
+    bool _readAheadPrimed { false };          // audio thread
+
+    // Playlist state (message thread, except the current item index)
+    juce::Array<juce::File> _queue;
+    std::atomic<int> _currentItem { 0 };
+    juce::int64 _itemStart { 0 };
+    juce::int64 _itemLength { 0 };
+    bool _preloadAttempted { false };
+
     // State management
     std::atomic<bool> _isInitialized { false };
     juce::File _currentFile;
@@ -110,6 +257,47 @@ private:
     // Helper methods
     void setupAudioFormats();
     void notifyError (const juce::String& message);
+    void notifyFileLoaded (const juce::File& file);
+    std::unique_ptr<juce::AudioFormatReader> createReaderFor (const juce::File& file);
+    void restartPreRender();
+    void configureSources();
+    void attachPlaylist (int readAhead);
+    int readAheadSize() const;
+    void updateReadAhead();
+    void countUnderrun (juce::int64 position, int numSamples) noexcept;
+    void switchDeviceSampleRate (double sampleRate);
+    void configureLiveDevice (bool enabled);
+    void processLive (const float* const* input, int numInputChannels, juce::AudioBuffer<float>& buffer) noexcept;
+    void saveDeviceState();
+    void updateIdle();
+    void suspendDevice();
+    void resumeDevice();
+    void readSource (float* const* channels, int numChannels, int numSamples) noexcept;
+    void readSourceResampled (juce::AudioBuffer<float>& buffer) noexcept;
+    void skipSource (int numSamples) noexcept;
+    void readPitchInput (juce::AudioBuffer<float>& input) noexcept;
+    void seekWithPreroll (double seconds);
+    void replayPreroll();
+    juce::int64 loopOffset (double seconds) const noexcept;
+    void dropLoop();
+    void updateLoop();
+    void readLoop (float* const* channels, int numChannels, int numSamples) noexcept;
+    static void copyLoop (const juce::AudioBuffer<float>& source, float* const* dest, int numChannels, juce::int64 position, int numSamples) noexcept;
+    static juce::AudioBuffer<float> foldLoop (const juce::AudioBuffer<float>& region, int fade);
+    bool readRendered (juce::AudioBuffer<float>& dest, juce::int64 startSample, int numSamples) const noexcept;
+    juce::int64 playheadInItem (juce::int64& hqEnd) const noexcept;
+    void processRetuner (juce::AudioBuffer<float>& buffer, juce::int64 playhead, juce::int64 hqEnd);
+    bool readPreRendered (juce::int64 startSample, int numSamples);
+    void mixPreRendered (juce::AudioBuffer<float>& buffer, float target);
+    void recordDry (const float* const* channels, int numChannels, juce::int64 position, int numSamples) noexcept;
+    bool copyDry (juce::AudioBuffer<float>& dest, juce::int64 startSample, int numSamples) const noexcept;
+    bool readDry (juce::int64 startSample, int numSamples) noexcept;
+    void mixDry (juce::AudioBuffer<float>& buffer, juce::int64 startSample) noexcept;
+    void fadeDry (juce::AudioBuffer<float>& buffer) noexcept;
+    void updatePlaylist();
+    void preloadNext();
+    void advanceTo (int item);
+    void timerCallback() override;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioEngine)
 };
@@ -0,0 +1,142 @@
+// Copyright (c) 2025 Kushview, LLC
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "decodespill.hpp"
+
+namespace retuner {
+namespace app {
+
+DecodeSpill::DecodeSpill (int numChannels, juce::int64 length)
+    : _numChannels (numChannels),
+      _length (length)
+{
+}
+
+DecodeSpill::~DecodeSpill() = default;
+
+std::unique_ptr<DecodeSpill> DecodeSpill::create (int numChannels, juce::int64 length, juce::int64 memoryBudget, bool allowFile)
+{
+    if (numChannels <= 0 || length <= 0)
+        return nullptr;
+
+    std::unique_ptr<DecodeSpill> spill (new DecodeSpill (numChannels, length));
+    const auto bytes = spill->sizeInBytes();
+
+    if (bytes <= memoryBudget && length <= std::numeric_limits<int>::max()) {
+        spill->_memory.setSize (numChannels, static_cast<int> (length), false, true);
+        return spill;
+    }
+
+    if (! allowFile)
+        return nullptr;
+
+    spill->_temporary = std::make_unique<juce::TemporaryFile> (".spill");
+    spill->_path = spill->_temporary->getFile();
+    return spill->openStream() ? std::move (spill) : nullptr;
+}
+
+std::unique_ptr<DecodeSpill> DecodeSpill::createFile (const juce::File& file, int numChannels, juce::int64 length)
+{
+    if (numChannels <= 0 || length <= 0)
+        return nullptr;
+
+    std::unique_ptr<DecodeSpill> spill (new DecodeSpill (numChannels, length));
+    spill->_path = file;
+    return spill->openStream() ? std::move (spill) : nullptr;
+}
+
+std::unique_ptr<DecodeSpill> DecodeSpill::open (const juce::File& file, int numChannels, juce::int64 length)
+{
+    if (numChannels <= 0 || length <= 0)
+        return nullptr;
+
+    std::unique_ptr<DecodeSpill> spill (new DecodeSpill (numChannels, length));
+    spill->_path = file;
+    return spill->map() ? std::move (spill) : nullptr;
+}
+
+juce::int64 DecodeSpill::sizeInBytes() const noexcept
+{
+    return static_cast<juce::int64> (_numChannels) * _length * static_cast<juce::int64> (sizeof (float));
+}
+
+bool DecodeSpill::openStream()
+{
+    // Size the file up front so it maps whole, whatever gets written
+    _path.deleteFile();
+    _stream = std::make_unique<juce::FileOutputStream> (_path);
+    return ! _stream->failedToOpen() && _stream->setPosition (sizeInBytes() - 1) && _stream->writeByte (0);
+}
+
+bool DecodeSpill::map()
+{
+    _map = std::make_unique<juce::MemoryMappedFile> (_path, juce::MemoryMappedFile::readOnly);
+    return _map->getData() != nullptr && static_cast<juce::int64> (_map->getSize()) >= sizeInBytes();
+}
+
+bool DecodeSpill::write (const juce::AudioBuffer<float>& source, juce::int64 position, int numSamples)
+{
+    numSamples = static_cast<int> (juce::jlimit<juce::int64> (0, _length - position, numSamples));
+    if (numSamples <= 0)
+        return true;
+
+    if (isInMemory()) {
+        for (int ch = 0; ch < _numChannels; ++ch)
+            _memory.copyFrom (ch, static_cast<int> (position), source, juce::jmin (ch, source.getNumChannels() - 1), 0, numSamples);
+        return true;
+    }
+
+    // Each channel has its own stretch of the file
+    if (_stream == nullptr)
+        return false;
+
+    for (int ch = 0; ch < _numChannels; ++ch) {
+        const auto offset = (static_cast<juce::int64> (ch) * _length + position) * static_cast<juce::int64> (sizeof (float));
+        if (! _stream->setPosition (offset)
+            || ! _stream->write (source.getReadPointer (juce::jmin (ch, source.getNumChannels() - 1)), sizeof (float) * (size_t) numSamples))
+            return false;
+    }
+
+    return true;
+}
+
+bool DecodeSpill::finishWriting()
+{
+    if (isInMemory())
+        return true;
+
+    if (_stream == nullptr)
+        return _map != nullptr;
+
+    _stream->flush();
+    const bool ok = _stream->getStatus().wasOk();
+    _stream.reset();
+    return ok && map();
+}
+
+const float* DecodeSpill::channel (int ch) const noexcept
+{
+    if (isInMemory())
+        return _memory.getReadPointer (ch);
+
+    if (_map == nullptr || _map->getData() == nullptr)
+        return nullptr;
+
+    return static_cast<const float*> (_map->getData()) + static_cast<juce::int64> (ch) * _length;
+}
+
+void DecodeSpill::read (juce::AudioBuffer<float>& dest, juce::int64 position, int numSamples) const
+{
+    const int available = static_cast<int> (juce::jlimit<juce::int64> (0, numSamples, _length - position));
+
+    for (int ch = 0; ch < dest.getNumChannels(); ++ch) {
+        const auto* data = channel (juce::jmin (ch, _numChannels - 1));
+        if (data != nullptr && available > 0)
+            dest.copyFrom (ch, 0, data + position, available);
+        if (available < numSamples || data == nullptr)
+            dest.clear (ch, data == nullptr ? 0 : available, data == nullptr ? numSamples : numSamples - available);
+    }
+}
+
+} // namespace app
+} // namespace retuner
@@ -0,0 +1,73 @@
+// Copyright (c) 2025 Kushview, LLC
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+
+namespace retuner {
+namespace app {
+
+/**
+ * Decoded audio kept between passes over the same input, so a compressed
+ * file only needs decoding once.
+ *
+ * Audio is held as planar float: in memory when it fits the budget, and
+ * otherwise in a temporary file that's memory-mapped once writing is done.
+ * The file holds each channel in turn at full length, so any range can be
+ * read back with one copy per channel.
+ */
+class DecodeSpill {
+public:
+    /**
+     * @param memoryBudget Largest size in bytes to hold in memory
+     * @param allowFile Whether to fall back to a temporary file when over budget
+     * @return nullptr if the audio can't be held within these limits
+     */
+    static std::unique_ptr<DecodeSpill> create (int numChannels, juce::int64 length, juce::int64 memoryBudget, bool allowFile);
+
+    /** Spill to a file that's kept afterwards, for caching the decode. */
+    static std::unique_ptr<DecodeSpill> createFile (const juce::File& file, int numChannels, juce::int64 length);
+
+    /** Map a file written by an earlier spill, ready to read. nullptr if it doesn't match. */
+    static std::unique_ptr<DecodeSpill> open (const juce::File& file, int numChannels, juce::int64 length);
+
+    ~DecodeSpill();
+
+    /** Store samples at a position. */
+    bool write (const juce::AudioBuffer<float>& source, juce::int64 position, int numSamples);
+
+    /** Call once everything has been written, before reading. */
+    bool finishWriting();
+
+    /** Read samples back. Channels past the spilled ones repeat its last, and samples past the end are silent. */
+    void read (juce::AudioBuffer<float>& dest, juce::int64 position, int numSamples) const;
+
+    int numChannels() const noexcept { return _numChannels; }
+    juce::int64 length() const noexcept { return _length; }
+    bool isInMemory() const noexcept { return _path == juce::File(); }
+
+private:
+    DecodeSpill (int numChannels, juce::int64 length);
+
+    const int _numChannels;
+    const juce::int64 _length;
+    juce::AudioBuffer<float> _memory;
+
+    // Declared so the mapping goes before the file it maps
+    std::unique_ptr<juce::TemporaryFile> _temporary;
+    juce::File _path;
+    std::unique_ptr<juce::FileOutputStream> _stream;
+    std::unique_ptr<juce::MemoryMappedFile> _map;
+
+    juce::int64 sizeInBytes() const noexcept;
+    bool openStream();
+    bool map();
+    const float* channel (int ch) const noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DecodeSpill)
+};
+
+} // namespace app
+} // namespace retuner
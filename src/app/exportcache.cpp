@@ -0,0 +1,139 @@
+// Copyright (c) 2025 Kushview, LLC
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "exportcache.hpp"
+
+namespace retuner {
+namespace app {
+
+namespace detail {
+/** Spill files without a description older than this were abandoned */
+static constexpr int abandonedHours = 24;
+/** Bytes hashed from each end of a file to confirm a cache entry */
+static constexpr int sampleHashBytes = 65536;
+} // namespace detail
+
+ExportCache::ExportCache (const juce::File& directory, juce::int64 budgetBytes)
+    : _directory (directory),
+      _budget (budgetBytes)
+{
+    _directory.createDirectory();
+}
+
+ExportCache::~ExportCache() = default;
+
+juce::String ExportCache::sampleHash (const juce::File& file)
+{
+    juce::FileInputStream stream (file);
+    if (! stream.openedOk())
+        return {};
+
+    const auto size = stream.getTotalLength();
+    const auto span = static_cast<int> (juce::jmin<juce::int64> (detail::sampleHashBytes, size));
+
+    juce::MemoryBlock data;
+    data.append (&size, sizeof (size));
+    stream.readIntoMemoryBlock (data, span);
+    if (size > span && stream.setPosition (size - span))
+        stream.readIntoMemoryBlock (data, span);
+
+    return juce::MD5 (data).toHexString();
+}
+
+juce::File ExportCache::audioFile (const juce::String& key) const
+{
+    return _directory.getChildFile (key + ".pcm");
+}
+
+juce::File ExportCache::infoFile (const juce::String& key) const
+{
+    return _directory.getChildFile (key + ".xml");
+}
+
+ExportCache::Entry ExportCache::find (const juce::File& file, const juce::AudioFormatReader& reader)
+{
+    Entry entry;
+    const auto numChannels = static_cast<int> (reader.numChannels);
+    const auto length = reader.lengthInSamples;
+
+    // Named for the file as it is now, so an edited file misses without any
+    // hashing. The decoder's layout is part of the key as well.
+    entry.key = juce::String::toHexString (file.getFullPathName().hashCode64())
+                + "-" + juce::String (file.getSize())
+                + "-" + juce::String (file.getLastModificationTime().toMilliseconds())
+                + "-" + juce::String (numChannels) + "-" + juce::String (length);
+
+    if (auto info = juce::XmlDocument::parse (infoFile (entry.key))) {
+        if (info->hasTagName ("ExportCacheEntry")
+            && info->getStringAttribute ("path") == file.getFullPathName()
+            && juce::approximatelyEqual (info->getDoubleAttribute ("sampleRate"), reader.sampleRate)
+            && info->getStringAttribute ("hash") == sampleHash (file)) {
+            entry.spill = DecodeSpill::open (audioFile (entry.key), numChannels, length);
+            if (entry.spill != nullptr) {
+                entry.decoded = true;
+                infoFile (entry.key).setLastModificationTime (juce::Time::getCurrentTime());
+                return entry;
+            }
+        }
+
+        infoFile (entry.key).deleteFile();
+    }
+
+    // Too big to ever fit isn't worth writing
+    const auto bytes = static_cast<juce::int64> (numChannels) * length * static_cast<juce::int64> (sizeof (float));
+    if (bytes <= _budget)
+        entry.spill = DecodeSpill::createFile (audioFile (entry.key), numChannels, length);
+    if (entry.spill == nullptr)
+        entry.key = {};
+
+    return entry;
+}
+
+void ExportCache::commit (const juce::String& key, const juce::File& file, const juce::AudioFormatReader& reader)
+{
+    if (key.isEmpty())
+        return;
+
+    juce::XmlElement info ("ExportCacheEntry");
+    info.setAttribute ("path", file.getFullPathName());
+    info.setAttribute ("hash", sampleHash (file));
+    info.setAttribute ("sampleRate", reader.sampleRate);
+    info.setAttribute ("numChannels", static_cast<int> (reader.numChannels));
+    info.setAttribute ("length", juce::String (reader.lengthInSamples));
+    info.setAttribute ("format", reader.getFormatName());
+    if (info.writeTo (infoFile (key)))
+        evict();
+}
+
+void ExportCache::evict()
+{
+    struct Cached {
+        juce::File info, audio;
+        juce::Time used;
+    };
+
+    std::vector<Cached> entries;
+    for (const auto& info : _directory.findChildFiles (juce::File::findFiles, false, "*.xml"))
+        entries.push_back ({ info, audioFile (info.getFileNameWithoutExtension()), info.getLastModificationTime() });
+
+    // Most recently used first; keep those while they fit
+    std::sort (entries.begin(), entries.end(), [] (const Cached& a, const Cached& b) { return a.used > b.used; });
+
+    juce::int64 total = 0;
+    for (const auto& entry : entries) {
+        total += entry.audio.getSize();
+        if (total > _budget || ! entry.audio.existsAsFile()) {
+            entry.info.deleteFile();
+            entry.audio.deleteFile();
+        }
+    }
+
+    // Spills left behind by exports that never finished
+    const auto abandoned = juce::Time::getCurrentTime() - juce::RelativeTime::hours (detail::abandonedHours);
+    for (const auto& audio : _directory.findChildFiles (juce::File::findFiles, false, "*.pcm"))
+        if (! infoFile (audio.getFileNameWithoutExtension()).existsAsFile() && audio.getLastModificationTime() < abandoned)
+            audio.deleteFile();
+}
+
+} // namespace app
+} // namespace retuner
@@ -0,0 +1,69 @@
+// Copyright (c) 2025 Kushview, LLC
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_core/juce_core.h>
+
+#include "decodespill.hpp"
+
+namespace retuner {
+namespace app {
+
+/**
+ * Decoded export input kept on disk between exports.
+ *
+ * Re-exporting a file at another A4 or in another format studies the same
+ * audio again, decoding it from scratch. The decoded audio is kept instead,
+ * and the next export studies straight from it.
+ *
+ * Entries are found by the file's path, size and modification time, as the
+ * MP3 seek index does, so a lookup costs no more than a stat. A hash of the
+ * start and end of the file, taken when the entry is made, confirms a match
+ * before it's used.
+ *
+ * Each entry is a spill file and a small description of it, which is only
+ * written once the spill is complete. The least recently used entries are
+ * removed to keep the whole cache under its budget.
+ */
+class ExportCache {
+public:
+    ExportCache (const juce::File& directory, juce::int64 budgetBytes);
+    ~ExportCache();
+
+    /** Decoded input for an export, either cached already or to be cached. */
+    struct Entry {
+        std::unique_ptr<DecodeSpill> spill;
+        juce::String key;
+        bool decoded { false }; // spill holds the whole input already
+    };
+
+    /**
+     * Look up the decoded audio for a file.
+     *
+     * On a hit the entry's spill is ready to read. Otherwise it's a new spill
+     * to fill; pass its key to commit() after DecodeSpill::finishWriting().
+     * The spill is null, and the key empty, if the cache can't hold this input.
+     */
+    Entry find (const juce::File& file, const juce::AudioFormatReader& reader);
+
+    /** Keep a freshly written spill for later exports. */
+    void commit (const juce::String& key, const juce::File& file, const juce::AudioFormatReader& reader);
+
+    /** Hash of a file's size and its first and last few kilobytes. */
+    static juce::String sampleHash (const juce::File& file);
+
+private:
+    juce::File _directory;
+    const juce::int64 _budget;
+
+    juce::File audioFile (const juce::String& key) const;
+    juce::File infoFile (const juce::String& key) const;
+    void evict();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ExportCache)
+};
+
+} // namespace app
+} // namespace retuner
@@ -33,6 +33,7 @@ ExportDialog::ExportDialog (const juce::File& inputFile)
     addAndMakeVisible (_qualityLabel.get());
 
     _qualityCombo = std::make_unique<juce::ComboBox>();
+    _qualityCombo->addItem ("Draft (Fast Preview)", 4);
     _qualityCombo->addItem ("Standard Quality", 1);
     _qualityCombo->addItem ("High Quality", 2);
     _qualityCombo->addItem ("Maximum Quality", 3);
@@ -45,10 +46,17 @@ ExportDialog::ExportDialog (const juce::File& inputFile)
     addAndMakeVisible (_formatLabel.get());
 
     _formatCombo = std::make_unique<juce::ComboBox>();
-    _formatCombo->addItem ("WAV", 1);
+    _formatCombo->addItem ("WAV (RF64 past 4 GB)", 1);
     _formatCombo->addItem ("AIFF", 2);
+    _formatCombo->addItem ("Wave64", 3);
+    _formatCombo->addItem ("FLAC", 4);
+    _formatCombo->addItem ("Ogg Vorbis", 5);
     _formatCombo->setSelectedId (1); // Default to WAV
-    _formatCombo->onChange = [this] { updateBitDepthOptions(); };
+    _formatCombo->onChange = [this] {
+        updateBitDepthOptions();
+        updateCompressionOptions();
+        updateOutputExtension();
+    };
     addAndMakeVisible (_formatCombo.get());
 
     // Bit depth
@@ -59,15 +67,45 @@ ExportDialog::ExportDialog (const juce::File& inputFile)
     _bitDepthCombo = std::make_unique<juce::ComboBox>();
     _bitDepthCombo->addItem ("16-bit", 1);
     _bitDepthCombo->addItem ("24-bit", 2);
-    _bitDepthCombo->addItem ("32-bit", 3);
+    _bitDepthCombo->addItem ("32-bit float", 3);
     _bitDepthCombo->setSelectedId (2); // Default to 24-bit
     addAndMakeVisible (_bitDepthCombo.get());
+    updateBitDepthOptions();
+
+    // Compression, for FLAC and Ogg Vorbis
+    _compressionLabel = std::make_unique<juce::Label> ("compressionLabel", "Compression:");
+    _compressionLabel->setJustificationType (juce::Justification::centredLeft);
+    addAndMakeVisible (_compressionLabel.get());
+
+    _compressionCombo = std::make_unique<juce::ComboBox>();
+    addAndMakeVisible (_compressionCombo.get());
+    updateCompressionOptions();
 
     // Upsampling
     _upsampleToggle = std::make_unique<juce::ToggleButton> ("Enable Upsampling (96kHz)");
     _upsampleToggle->setToggleState (false, juce::dontSendNotification);
     addAndMakeVisible (_upsampleToggle.get());
 
+    // Parallel segments, for long files on many cores
+    _segmentToggle = std::make_unique<juce::ToggleButton> ("Process in Parallel Segments (faster on long files)");
+    _segmentToggle->setToggleState (false, juce::dontSendNotification);
+    addAndMakeVisible (_segmentToggle.get());
+
+    // Flat memory use, for recordings many hours long
+    _memoryToggle = std::make_unique<juce::ToggleButton> ("Limit Memory Use (for multi-hour recordings)");
+    _memoryToggle->setToggleState (false, juce::dontSendNotification);
+    addAndMakeVisible (_memoryToggle.get());
+
+    // Extra targets, exported from the same decode
+    _targetsLabel = std::make_unique<juce::Label> ("targetsLabel", "Also At:");
+    _targetsLabel->setJustificationType (juce::Justification::centredLeft);
+    addAndMakeVisible (_targetsLabel.get());
+
+    _targetsEditor = std::make_unique<juce::TextEditor>();
+    _targetsEditor->setInputRestrictions (0, "0123456789., ");
+    _targetsEditor->setTextToShowWhenEmpty ("Other A4 frequencies in Hz, e.g. 415, 444", juce::Colours::grey);
+    addAndMakeVisible (_targetsEditor.get());
+
     // Buttons
     _exportButton = std::make_unique<juce::TextButton> ("Export");
     _exportButton->onClick = [this]() { if (onExport) onExport(); };
@@ -77,7 +115,7 @@ ExportDialog::ExportDialog (const juce::File& inputFile)
     _cancelButton->onClick = [this]() { if (onCancel) onCancel(); };
     addAndMakeVisible (_cancelButton.get());
 
-    setSize (500, 280);
+    setSize (500, 430);
 }
 
 ExportDialog::~ExportDialog() = default;
@@ -128,10 +166,32 @@ void ExportDialog::resized()
 
     bounds.removeFromTop (spacing);
 
+    // Compression
+    row = bounds.removeFromTop (rowHeight);
+    _compressionLabel->setBounds (row.removeFromLeft (labelWidth));
+    row.removeFromLeft (spacing);
+    _compressionCombo->setBounds (row);
+
+    bounds.removeFromTop (spacing);
+
     // Upsampling
     row = bounds.removeFromTop (rowHeight);
     _upsampleToggle->setBounds (row);
 
+    row = bounds.removeFromTop (rowHeight);
+    _segmentToggle->setBounds (row);
+
+    row = bounds.removeFromTop (rowHeight);
+    _memoryToggle->setBounds (row);
+
+    bounds.removeFromTop (spacing);
+
+    // Extra targets
+    row = bounds.removeFromTop (rowHeight);
+    _targetsLabel->setBounds (row.removeFromLeft (labelWidth));
+    row.removeFromLeft (spacing);
+    _targetsEditor->setBounds (row);
+
     bounds.removeFromTop (spacing * 2);
 
     // Buttons
@@ -145,7 +205,7 @@ void ExportDialog::resized()
 void ExportDialog::browseButtonClicked()
 {
     auto flags = juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles;
-    auto defaultExtension = format() == "wav" ? "*.wav" : "*.aiff";
+    auto defaultExtension = "*." + format();
 
     _fileChooser = std::make_unique<juce::FileChooser> (
         "Choose export location...",
@@ -155,10 +215,9 @@ void ExportDialog::browseButtonClicked()
     _fileChooser->launchAsync (flags, [this] (const juce::FileChooser& chooser) {
         auto result = chooser.getResult();
         if (result != juce::File()) {
-            // Ensure correct extension
-            auto extension = format() == "wav" ? ".wav" : ".aiff";
-            if (! result.hasFileExtension (extension))
-                result = result.withFileExtension (extension);
+            // Ensure correct extension; each format's name is its extension
+            if (! result.hasFileExtension (format()))
+                result = result.withFileExtension (format());
 
             _outputPathEditor->setText (result.getFullPathName());
         }
@@ -167,8 +226,44 @@ void ExportDialog::browseButtonClicked()
 
 void ExportDialog::updateBitDepthOptions()
 {
-    // All options available for both WAV and AIFF
-    // No changes needed currently
+    // WAV and Wave64 store 32 bits as float, AIFF as integer, and FLAC
+    // only goes to 24. Vorbis doesn't have a bit depth at all.
+    _bitDepthCombo->changeItemText (3, format() == "aiff" ? "32-bit" : "32-bit float");
+    _bitDepthCombo->setItemEnabled (3, format() != "flac");
+    if (format() == "flac" && _bitDepthCombo->getSelectedId() == 3)
+        _bitDepthCombo->setSelectedId (2);
+    _bitDepthCombo->setEnabled (format() != "ogg");
+}
+
+void ExportDialog::updateCompressionOptions()
+{
+    _compressionCombo->clear (juce::dontSendNotification);
+
+    juce::StringArray options;
+    if (format() == "flac")
+        options = juce::FlacAudioFormat().getQualityOptions();
+    else if (format() == "ogg")
+        options = juce::OggVorbisAudioFormat().getQualityOptions();
+
+    // Item IDs are the option index plus one
+    for (int i = 0; i < options.size(); ++i)
+        _compressionCombo->addItem (options[i], i + 1);
+
+    if (options.isEmpty()) {
+        _compressionCombo->setTextWhenNothingSelected ("None");
+        _compressionCombo->setEnabled (false);
+        return;
+    }
+
+    _compressionCombo->setSelectedId (Exporter::defaultCompressionLevel (format()) + 1, juce::dontSendNotification);
+    _compressionCombo->setEnabled (true);
+}
+
+void ExportDialog::updateOutputExtension()
+{
+    const auto output = outputFile();
+    if (output != juce::File() && ! output.hasFileExtension (format()))
+        _outputPathEditor->setText (output.withFileExtension (format()).getFullPathName());
 }
 
 juce::File ExportDialog::outputFile() const
@@ -185,6 +280,8 @@ Exporter::Quality ExportDialog::quality() const
             return Exporter::Quality::High;
         case 3:
             return Exporter::Quality::Maximum;
+        case 4:
+            return Exporter::Quality::Draft;
         default:
             return Exporter::Quality::High;
     }
@@ -192,7 +289,18 @@ Exporter::Quality ExportDialog::quality() const
 
 juce::String ExportDialog::format() const
 {
-    return _formatCombo->getSelectedId() == 1 ? "wav" : "aiff";
+    switch (_formatCombo->getSelectedId()) {
+        case 2:
+            return "aiff";
+        case 3:
+            return "w64";
+        case 4:
+            return "flac";
+        case 5:
+            return "ogg";
+        default:
+            return "wav";
+    }
 }
 
 int ExportDialog::bitDepth() const
@@ -209,10 +317,50 @@ int ExportDialog::bitDepth() const
     }
 }
 
+int ExportDialog::compressionLevel() const
+{
+    return _compressionCombo->isEnabled() ? _compressionCombo->getSelectedId() - 1 : -1;
+}
+
 bool ExportDialog::shouldUpsample() const
 {
     return _upsampleToggle->getToggleState();
 }
 
+bool ExportDialog::shouldSplitIntoSegments() const
+{
+    return _segmentToggle->getToggleState();
+}
+
+bool ExportDialog::shouldLimitMemory() const
+{
+    return _memoryToggle->getToggleState();
+}
+
+juce::Array<float> ExportDialog::extraTargetFrequencies() const
+{
+    juce::Array<float> frequencies;
+    for (const auto& token : juce::StringArray::fromTokens (_targetsEditor->getText(), ", ", {})) {
+        const auto frequency = token.getFloatValue();
+        if (frequency > 0.0f)
+            frequencies.addIfNotAlreadyThere (frequency);
+    }
+    return frequencies;
+}
+
+juce::File ExportDialog::outputFileFor (float frequency) const
+{
+    const auto output = outputFile();
+
+    // Swap a trailing "_432Hz" style suffix for this frequency's
+    auto name = output.getFileNameWithoutExtension();
+    const auto suffix = name.fromLastOccurrenceOf ("_", false, false);
+    if (suffix.endsWithIgnoreCase ("Hz") && suffix.dropLastCharacters (2).containsOnly ("0123456789."))
+        name = name.upToLastOccurrenceOf ("_", false, false);
+
+    return output.getSiblingFile (name + "_" + juce::String (frequency, 2).trimCharactersAtEnd ("0").trimCharactersAtEnd (".") + "Hz")
+        .withFileExtension (output.getFileExtension());
+}
+
 } // namespace app
 } // namespace retuner
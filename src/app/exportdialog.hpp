@@ -29,11 +29,22 @@ public:
     Exporter::Quality quality() const;
     juce::String format() const;
     int bitDepth() const;
+    int compressionLevel() const;
     bool shouldUpsample() const;
+    bool shouldSplitIntoSegments() const;
+    bool shouldLimitMemory() const;
+
+    /** Further A4 frequencies to export alongside the current one */
+    juce::Array<float> extraTargetFrequencies() const;
+
+    /** Output file for an extra target, named after its frequency next to outputFile() */
+    juce::File outputFileFor (float frequency) const;
 
 private:
     void browseButtonClicked();
     void updateBitDepthOptions();
+    void updateCompressionOptions();
+    void updateOutputExtension();
 
     // Input file reference
     juce::File _inputFile;
@@ -52,7 +63,15 @@ private:
     std::unique_ptr<juce::ComboBox> _formatCombo;
     std::unique_ptr<juce::Label> _bitDepthLabel;
     std::unique_ptr<juce::ComboBox> _bitDepthCombo;
+    std::unique_ptr<juce::Label> _compressionLabel;
+    std::unique_ptr<juce::ComboBox> _compressionCombo;
     std::unique_ptr<juce::ToggleButton> _upsampleToggle;
+    std::unique_ptr<juce::ToggleButton> _segmentToggle;
+    std::unique_ptr<juce::ToggleButton> _memoryToggle;
+
+    // Extra targets
+    std::unique_ptr<juce::Label> _targetsLabel;
+    std::unique_ptr<juce::TextEditor> _targetsEditor;
 
     // File chooser
     std::unique_ptr<juce::FileChooser> _fileChooser;
@@ -1,15 +1,694 @@
 // Copyright (c) 2025 Kushview, LLC
 // SPDX-License-Identifier: GPL-3.0-or-later
 
+#include <algorithm>
+#include <deque>
+
 #include "exporter.hpp"
+#include "decodespill.hpp"
+#include "exportcache.hpp"
+#include "exportpipeline.hpp"
+#include "wave64format.hpp"
+#include "../resampler.hpp"
 
 namespace retuner {
 namespace app {
 
+namespace detail {
+/** Decoded input held in memory between the study and process passes */
+static constexpr juce::int64 spillMemoryBudget = juce::int64 (1) << 30;
+
+/** Blocks in flight between each pair of export stages */
+static constexpr int pipelineDepth = 4;
+
+/** Samples fed to a stretcher at a time */
+static constexpr int blockSize = 8192;
+
+/** Output file buffering, so large files go to disk in large writes */
+static constexpr size_t outputBufferBytes = 1 << 20;
+
+/** Most audio an AIFF file's 32-bit sizes can describe, less room for its header */
+static constexpr juce::int64 aiffMaxBytes = (juce::int64 (1) << 32) - 1024;
+
+/** FLAC's usual compression level, as its command line tool uses */
+static constexpr int flacDefaultLevel = 5;
+
+/** Ogg Vorbis bitrate used unless asked otherwise; 192 kbps in JUCE's list */
+static constexpr int oggDefaultQuality = 6;
+
+/** Blocks of silence a draft may flush beyond its remaining output before giving up */
+static constexpr int draftFlushMarginBlocks = 16;
+
+static const char* const cancelledMessage = "Export cancelled by user";
+
+/** True for formats that are costly to decode a second time. */
+inline static bool isCompressed (const juce::AudioFormatReader& reader)
+{
+    const auto format = reader.getFormatName();
+    return ! (format.startsWithIgnoreCase ("WAV") || format.startsWithIgnoreCase ("AIFF"));
+}
+
+/**
+ * Writes stretcher output to a file at another sample rate, converting it
+ * with the polyphase resampler on the way.
+ */
+class ResamplingWriter {
+public:
+    ResamplingWriter (juce::AudioFormatWriter& writer, double inputRate, double outputRate, int numChannels)
+        : _writer (writer),
+          _numChannels (numChannels),
+          _resample (! juce::approximatelyEqual (inputRate, outputRate)),
+          _ratio (outputRate / inputRate)
+    {
+        if (_resample) {
+            _resampler.prepare (inputRate, outputRate, numChannels, blockSize, dsp::Resampler::Quality::Maximum);
+            _output.setSize (numChannels, blockSize);
+        }
+    }
+
+    /** Write samples at the input rate. */
+    bool write (const juce::AudioBuffer<float>& buffer, int numSamples)
+    {
+        if (! _resample)
+            return _writer.writeFromAudioSampleBuffer (buffer, 0, numSamples);
+
+        append (buffer, numSamples);
+        _numInput += numSamples;
+        return drain (false);
+    }
+
+    /** Flush the resampler's look-ahead so the output is as long as the input. */
+    bool finish()
+    {
+        if (! _resample)
+            return true;
+
+        // Silence flushes the last input out of the filters
+        juce::AudioBuffer<float> silence (_numChannels, _resampler.numTaps());
+        silence.clear();
+        append (silence, silence.getNumSamples());
+        return drain (true);
+    }
+
+private:
+    static constexpr int blockSize = 4096;
+
+    juce::AudioFormatWriter& _writer;
+    const int _numChannels;
+    const bool _resample;
+    const double _ratio;
+    dsp::Resampler _resampler;
+    juce::AudioBuffer<float> _pending;
+    int _numPending { 0 };
+    juce::AudioBuffer<float> _output;
+    juce::int64 _numInput { 0 };
+    juce::int64 _numWritten { 0 };
+
+    void append (const juce::AudioBuffer<float>& buffer, int numSamples)
+    {
+        if (_numPending + numSamples > _pending.getNumSamples())
+            _pending.setSize (_numChannels, _numPending + numSamples, true, false, true);
+        for (int ch = 0; ch < _numChannels; ++ch)
+            _pending.copyFrom (ch, _numPending, buffer, juce::jmin (ch, buffer.getNumChannels() - 1), 0, numSamples);
+        _numPending += numSamples;
+    }
+
+    bool drain (bool final)
+    {
+        const auto total = static_cast<juce::int64> (std::llround (static_cast<double> (_numInput) * _ratio));
+        std::vector<const float*> input (static_cast<size_t> (_numChannels));
+        int used = 0;
+
+        for (;;) {
+            auto n = blockSize;
+            if (final)
+                n = static_cast<int> (juce::jmin<juce::int64> (n, total - _numWritten));
+
+            const int needed = _resampler.inputRequired (n);
+            if (n <= 0 || needed > _numPending - used)
+                break;
+
+            for (int ch = 0; ch < _numChannels; ++ch)
+                input[(size_t) ch] = _pending.getReadPointer (ch, used);
+
+            _resampler.process (input.data(), _output.getArrayOfWritePointers(), _numChannels, n);
+            used += needed;
+
+            if (! _writer.writeFromAudioSampleBuffer (_output, 0, n))
+                return false;
+            _numWritten += n;
+        }
+
+        // Keep the input the resampler hasn't reached yet
+        _numPending -= used;
+        for (int ch = 0; ch < _numChannels; ++ch) {
+            auto* data = _pending.getWritePointer (ch);
+            std::memmove (data, data + used, sizeof (float) * static_cast<size_t> (_numPending));
+        }
+
+        return true;
+    }
+};
+
+/**
+ * Hands rendered audio to one or more output files at once.
+ *
+ * Each output converts and encodes on a thread of its own, fed through its
+ * own queue, so several formats and bit depths cost one render and only the
+ * slowest output holds it up.
+ */
+class WriterFan {
+public:
+    WriterFan (int numChannels, int blockSize, std::atomic<bool>& abort, const Exporter::ProgressCallback& progress)
+        : _numChannels (numChannels),
+          _blockSize (blockSize),
+          _abort (abort),
+          _progress (progress) {}
+
+    /** Add an output taking audio at @p inputRate; call before start(). */
+    void add (const juce::File& file, std::unique_ptr<juce::AudioFormatWriter> writer, double inputRate)
+    {
+        auto output = std::make_unique<Output>();
+        output->file = file;
+        output->rate = inputRate;
+        output->resampler = std::make_unique<ResamplingWriter> (*writer, inputRate, writer->getSampleRate(), _numChannels);
+        output->writer = std::move (writer);
+        output->queue = std::make_unique<BlockQueue> (pipelineDepth, _numChannels, _blockSize, _abort);
+
+        // Its queue, and a block at the output rate for the resampler
+        const auto ratio = juce::jmax (1.0, output->writer->getSampleRate() / inputRate);
+        _heldBytes += static_cast<juce::int64> ((pipelineDepth + ratio) * _blockSize * _numChannels * sizeof (float));
+        _outputs.push_back (std::move (output));
+    }
+
+    void start()
+    {
+        for (auto& output : _outputs) {
+            auto* o = output.get();
+            o->thread = std::make_unique<StageThread> ("Export Write", _abort, _progress.onThreadStart, _progress.onThreadEnd,
+                                                       [this, o] { run (*o); });
+            o->thread->startThread();
+        }
+    }
+
+    /** Copy samples to every output. Waits while the slowest is behind; false once aborted. */
+    bool write (const juce::AudioBuffer<float>& buffer, int offset, int numSamples)
+    {
+        for (int done = 0; done < numSamples;) {
+            const int n = juce::jmin (_blockSize, numSamples - done);
+            for (auto& output : _outputs) {
+                auto* block = output->queue->acquire();
+                if (block == nullptr)
+                    return false;
+
+                for (int ch = 0; ch < _numChannels; ++ch)
+                    block->audio.copyFrom (ch, 0, buffer, juce::jmin (ch, buffer.getNumChannels() - 1), offset + done, n);
+                block->numSamples = n;
+                output->queue->push (block);
+            }
+            done += n;
+        }
+        return true;
+    }
+
+    /** End every output and wait for them all to be written. */
+    bool finish()
+    {
+        for (auto& output : _outputs) {
+            if (auto* block = output->queue->acquire()) {
+                block->last = true;
+                output->queue->push (block);
+            }
+        }
+
+        for (auto& output : _outputs)
+            output->thread->waitForThreadToExit (-1);
+
+        return error().isEmpty() && ! _abort;
+    }
+
+    /** The first output error, once the outputs have finished. */
+    juce::String error() const
+    {
+        const juce::ScopedLock sl (_errorLock);
+        return _error;
+    }
+
+    /** Why writing stopped early: an output's error, or else cancelling. */
+    juce::Result failure() const
+    {
+        const auto message = error();
+        return juce::Result::fail (message.isNotEmpty() ? message : juce::String (cancelledMessage));
+    }
+
+    /** How busy the busiest output has been. */
+    double load() const noexcept
+    {
+        double busiest = 0.0;
+        for (auto& output : _outputs)
+            busiest = juce::jmax (busiest, output->clock.load());
+        return busiest;
+    }
+
+    void resetClocks() noexcept
+    {
+        for (auto& output : _outputs)
+            output->clock.reset();
+    }
+
+    /** Times real time the slowest output encodes at, over the time it has spent encoding. */
+    double speed() const noexcept
+    {
+        double slowest = 0.0;
+        for (auto& output : _outputs) {
+            const auto busy = output->clock.busySeconds();
+            if (busy <= 0.0)
+                return 0.0;
+
+            const auto speed = static_cast<double> (output->written.load()) / output->rate / busy;
+            slowest = slowest > 0.0 ? juce::jmin (slowest, speed) : speed;
+        }
+        return slowest;
+    }
+
+    /** Memory the outputs hold for audio, whatever gets written. */
+    juce::int64 heldBytes() const noexcept { return _heldBytes; }
+
+private:
+    // Declared so each output's thread stops before its queue and writer go
+    struct Output {
+        juce::File file;
+        double rate { 0.0 };                   // input rate
+        std::atomic<juce::int64> written { 0 }; // input samples encoded
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+        std::unique_ptr<ResamplingWriter> resampler;
+        std::unique_ptr<BlockQueue> queue;
+        StageClock clock;
+        std::unique_ptr<StageThread> thread;
+    };
+
+    const int _numChannels, _blockSize;
+    std::atomic<bool>& _abort;
+    const Exporter::ProgressCallback& _progress;
+    juce::int64 _heldBytes { 0 };
+    std::vector<std::unique_ptr<Output>> _outputs;
+    juce::CriticalSection _errorLock;
+    juce::String _error;
+
+    void run (Output& output)
+    {
+        for (;;) {
+            auto* block = output.queue->pop();
+            if (block == nullptr)
+                return;
+
+            const bool last = block->last;
+            bool ok = true;
+            {
+                const StageClock::Busy busy (output.clock);
+                if (block->numSamples > 0)
+                    ok = output.resampler->write (block->audio, block->numSamples);
+                if (ok && last)
+                    ok = output.resampler->finish();
+            }
+            output.written += block->numSamples;
+            output.queue->release (block);
+
+            if (! ok) {
+                const juce::ScopedLock sl (_errorLock);
+                if (_error.isEmpty())
+                    _error = "Could not write to output file: " + output.file.getFullPathName();
+                _abort = true;
+                return;
+            }
+
+            if (last)
+                return;
+        }
+    }
+};
+
+/** Input rendered either side of a segment for the stretcher to settle */
+static constexpr double segmentPaddingSeconds = 1.0;
+
+/** Length of the crossfade joining neighbouring segments */
+static constexpr double segmentCrossfadeSeconds = 0.25;
+
+/** Segments rendered ahead of the one being written, per thread */
+static constexpr int segmentsAheadPerThread = 2;
+
+/** Shortest a memory limit may cut segments down to */
+static constexpr double minimumSegmentSeconds = 5.0;
+
+/** Stretcher state per segment on top of its audio, with room to spare */
+static constexpr juce::int64 stretcherBytes = juce::int64 (16) << 20;
+
+/** Most a segment holds while it renders: renderRange keeps its input, its render and the result. */
+static juce::int64 segmentBytes (juce::int64 length, int padding, int numChannels)
+{
+    const auto samples = 3 * length + 4 * static_cast<juce::int64> (padding);
+    return samples * numChannels * static_cast<juce::int64> (sizeof (float)) + stretcherBytes;
+}
+
+/** Renders one segment of the input on a pool thread. */
+class SegmentJob : public juce::ThreadPoolJob {
+public:
+    SegmentJob (juce::AudioFormatManager& formatManager,
+                const juce::File& file,
+                juce::int64 start,
+                int length,
+                int padding,
+                const Exporter::ExportSettings& settings,
+                float pitchRatio,
+                const Exporter::ProgressCallback& progress,
+                const std::atomic<bool>& abort)
+        : juce::ThreadPoolJob ("Export Segment"),
+          _formatManager (formatManager),
+          _file (file),
+          _start (start),
+          _length (length),
+          _padding (padding),
+          _settings (settings),
+          _pitchRatio (pitchRatio),
+          _progress (progress),
+          _abort (abort) {}
+
+    JobStatus runJob() override
+    {
+        if (_progress.onThreadStart)
+            _progress.onThreadStart();
+
+        std::unique_ptr<juce::AudioFormatReader> reader (_formatManager.createReaderFor (_file));
+        if (reader == nullptr) {
+            _result = juce::Result::fail ("Could not open input file: " + _file.getFullPathName());
+        } else {
+            _held = segmentBytes (_length, _padding, static_cast<int> (reader->numChannels));
+            _result = Exporter::renderRange (*reader, _start, _length, _padding, _settings, _pitchRatio, _output,
+                                             [this]() { return _abort.load() || shouldExit(); });
+        }
+        _held = static_cast<juce::int64> (_output.getNumChannels()) * _output.getNumSamples() * static_cast<juce::int64> (sizeof (float));
+
+        if (_progress.onThreadEnd)
+            _progress.onThreadEnd();
+        return jobHasFinished;
+    }
+
+    juce::int64 start() const noexcept { return _start; }
+    const juce::Result& result() const noexcept { return _result; }
+    const juce::AudioBuffer<float>& output() const noexcept { return _output; }
+
+    /** Memory the job holds for audio: none until it starts, then its render, then only the result. */
+    juce::int64 heldBytes() const noexcept { return _held.load(); }
+
+private:
+    juce::AudioFormatManager& _formatManager;
+    const juce::File _file;
+    const juce::int64 _start;
+    const int _length, _padding;
+    const Exporter::ExportSettings& _settings;
+    const float _pitchRatio;
+    const Exporter::ProgressCallback& _progress;
+    const std::atomic<bool>& _abort;
+    juce::Result _result { juce::Result::ok() };
+    juce::AudioBuffer<float> _output;
+    std::atomic<juce::int64> _held { 0 };
+};
+
+/**
+ * Crossfade the end of one segment into the start of the next.
+ *
+ * Both renders cover the same input, but the stretchers reach it with
+ * different phases. Where they still line up a plain linear fade keeps the
+ * level, while out of phase material needs an equal-power fade to avoid a
+ * dip. The gains follow the measured correlation between the two so the
+ * summed level stays flat either way.
+ */
+static void crossfade (const juce::AudioBuffer<float>& outgoing, int outgoingOffset,
+                       const juce::AudioBuffer<float>& incoming, int incomingOffset,
+                       juce::AudioBuffer<float>& dest, int numSamples)
+{
+    double cross = 0.0, outgoingEnergy = 0.0, incomingEnergy = 0.0;
+    for (int ch = 0; ch < dest.getNumChannels(); ++ch) {
+        const auto* a = outgoing.getReadPointer (ch, outgoingOffset);
+        const auto* b = incoming.getReadPointer (ch, incomingOffset);
+        for (int i = 0; i < numSamples; ++i) {
+            cross += static_cast<double> (a[i]) * b[i];
+            outgoingEnergy += static_cast<double> (a[i]) * a[i];
+            incomingEnergy += static_cast<double> (b[i]) * b[i];
+        }
+    }
+
+    const auto norm = std::sqrt (outgoingEnergy * incomingEnergy);
+    const auto correlation = norm > 0.0 ? juce::jlimit (0.0, 1.0, cross / norm) : 1.0;
+
+    for (int i = 0; i < numSamples; ++i) {
+        const auto t = (static_cast<double> (i) + 0.5) / static_cast<double> (numSamples);
+
+        // Scale a linear fade so a^2 + b^2 + 2ab.correlation == 1
+        const auto gain = 1.0 / std::sqrt ((1.0 - t) * (1.0 - t) + t * t + 2.0 * correlation * t * (1.0 - t));
+        const auto fadeOut = static_cast<float> ((1.0 - t) * gain);
+        const auto fadeIn = static_cast<float> (t * gain);
+
+        for (int ch = 0; ch < dest.getNumChannels(); ++ch)
+            dest.setSample (ch, i, outgoing.getSample (ch, outgoingOffset + i) * fadeOut + incoming.getSample (ch, incomingOffset + i) * fadeIn);
+    }
+}
+
+/**
+ * Stretch the input in overlapping segments on a thread pool and write them
+ * out in order.
+ *
+ * Segment boundaries depend only on the input and settings, and each segment
+ * is rendered by its own single-threaded stretcher, so the output doesn't
+ * depend on how many threads did the work or in which order they finished.
+ *
+ * Only a few segments per thread are held at once, so memory doesn't grow
+ * with the input. Under a memory limit, threads and then segment length are
+ * cut until the most that can be held fits.
+ */
+static juce::Result exportSegments (juce::AudioFormatManager& formatManager,
+                                    const juce::File& inputFile,
+                                    const juce::AudioFormatReader& reader,
+                                    WriterFan& output,
+                                    const Exporter::ExportSettings& settings,
+                                    float pitchRatio,
+                                    const Exporter::ProgressCallback& progress)
+{
+    const auto totalSamples = reader.lengthInSamples;
+    const int numChannels = static_cast<int> (reader.numChannels);
+    const int padding = juce::roundToInt (reader.sampleRate * segmentPaddingSeconds);
+    const int fade = juce::jmax (2, juce::roundToInt (reader.sampleRate * segmentCrossfadeSeconds)) & ~1;
+    const int half = fade / 2;
+
+    // Short last segments are folded into the one before, so each is
+    // comfortably longer than the crossfade
+    auto lengthFor = [&] (double seconds) {
+        return juce::jmax<juce::int64> (4 * fade, static_cast<juce::int64> (reader.sampleRate * seconds));
+    };
+
+    // Every queued segment may be as long as one and a half, with the crossfade
+    const auto fadeBytes = 2 * static_cast<juce::int64> (fade) * numChannels * static_cast<juce::int64> (sizeof (float));
+    auto mostHeld = [&] (double seconds, int threads) {
+        const auto longest = lengthFor (seconds) * 3 / 2 + fade;
+        return threads * segmentsAheadPerThread * segmentBytes (longest, padding, numChannels) + output.heldBytes() + fadeBytes;
+    };
+
+    auto segmentSeconds = settings.segmentSeconds;
+    int numThreads = settings.numThreads > 0 ? settings.numThreads : juce::SystemStats::getNumCpus();
+    if (settings.memoryLimit > 0) {
+        while (numThreads > 1 && mostHeld (segmentSeconds, numThreads) > settings.memoryLimit)
+            --numThreads;
+        while (segmentSeconds > minimumSegmentSeconds && mostHeld (segmentSeconds, numThreads) > settings.memoryLimit)
+            segmentSeconds = juce::jmax (minimumSegmentSeconds, segmentSeconds * 0.75);
+
+        const auto needed = mostHeld (segmentSeconds, numThreads);
+        if (needed > settings.memoryLimit)
+            return juce::Result::fail ("The memory limit is too low for this file; it needs at least "
+                                       + juce::File::descriptionOfSizeInBytes (needed));
+    }
+
+    const auto segmentLength = lengthFor (segmentSeconds);
+    const auto numSegments = juce::jmax<juce::int64> (1, (totalSamples + segmentLength / 2) / segmentLength);
+    if (totalSamples <= 0)
+        return output.finish() ? juce::Result::ok() : output.failure();
+    if (segmentLength + fade + 2 * padding > std::numeric_limits<int>::max())
+        return juce::Result::fail ("Segment length is too long");
+
+    auto segmentStart = [&] (juce::int64 i) { return i * segmentLength; };
+    auto segmentEnd = [&] (juce::int64 i) { return i == numSegments - 1 ? totalSamples : (i + 1) * segmentLength; };
+
+    std::atomic<bool> abort { false };
+    std::deque<std::unique_ptr<SegmentJob>> jobs;
+    juce::ThreadPool pool (numThreads, 0, juce::Thread::Priority::low);
+
+    auto fail = [&] (const juce::String& message) {
+        abort = true;
+        pool.removeAllJobs (true, -1);
+        return juce::Result::fail (message);
+    };
+
+    // Each segment overlaps its neighbours by half a crossfade on either side
+    juce::int64 nextToQueue = 0;
+    auto queueSegments = [&]() {
+        while (nextToQueue < numSegments && static_cast<int> (jobs.size()) < numThreads * segmentsAheadPerThread) {
+            const auto first = juce::jmax<juce::int64> (0, segmentStart (nextToQueue) - half);
+            const auto last = juce::jmin (totalSamples, segmentEnd (nextToQueue) + half);
+            jobs.push_back (std::make_unique<SegmentJob> (formatManager, inputFile, first, static_cast<int> (last - first),
+                                                          padding, settings, pitchRatio, progress, abort));
+            pool.addJob (jobs.back().get(), false);
+            ++nextToQueue;
+        }
+    };
+
+    juce::AudioBuffer<float> tail (numChannels, fade);
+    juce::AudioBuffer<float> joined (numChannels, fade);
+
+    auto reportMemory = [&]() {
+        if (! progress.onMemoryUsage)
+            return;
+        auto held = output.heldBytes() + fadeBytes;
+        for (const auto& queued : jobs)
+            held += queued->heldBytes();
+        progress.onMemoryUsage (held);
+    };
+
+    for (juce::int64 i = 0; i < numSegments; ++i) {
+        queueSegments();
+        auto& job = *jobs.front();
+
+        while (! pool.waitForJobToFinish (&job, 50)) {
+            if (progress.shouldCancel && progress.shouldCancel())
+                return fail (cancelledMessage);
+            reportMemory();
+        }
+
+        if (progress.shouldCancel && progress.shouldCancel())
+            return fail (cancelledMessage);
+        if (job.result().failed())
+            return fail (job.result().getErrorMessage());
+
+        const auto& rendered = job.output();
+        const auto start = segmentStart (i);
+        const auto end = segmentEnd (i);
+
+        // Join on to the previous segment's tail, then write the body up to
+        // where this segment's own tail starts
+        auto bodyStart = start;
+        if (i > 0) {
+            crossfade (tail, 0, rendered, 0, joined, fade);
+            if (! output.write (joined, 0, fade))
+                return fail (output.failure().getErrorMessage());
+            bodyStart = start + half;
+        }
+
+        const auto bodyEnd = i < numSegments - 1 ? end - half : end;
+        const auto offset = static_cast<int> (bodyStart - job.start());
+        if (! output.write (rendered, offset, static_cast<int> (bodyEnd - bodyStart)))
+            return fail (output.failure().getErrorMessage());
+
+        if (i < numSegments - 1)
+            for (int ch = 0; ch < numChannels; ++ch)
+                tail.copyFrom (ch, 0, rendered, ch, static_cast<int> (bodyEnd - job.start()), fade);
+
+        reportMemory();
+        jobs.pop_front();
+
+        if (progress.onProgress)
+            progress.onProgress (static_cast<double> (i + 1) / static_cast<double> (numSegments));
+        if (progress.onEncodeSpeed && output.speed() > 0.0)
+            progress.onEncodeSpeed (output.speed());
+    }
+
+    if (! output.finish())
+        return output.failure();
+
+    return juce::Result::ok();
+}
+
+/** Share of a multi-target export's progress spent decoding */
+static constexpr double fanOutDecodeShare = 0.1;
+
+/** How often a multi-target export checks on its targets */
+static constexpr int fanOutPollMs = 50;
+
+/**
+ * Study and process decoded input with a stretcher of its own, writing the
+ * result. Several of these run side by side for a multi-target export.
+ */
+static juce::Result renderTarget (const DecodeSpill* spill,
+                                  double sampleRate,
+                                  int numChannels,
+                                  const Exporter::ExportSettings& settings,
+                                  float pitchRatio,
+                                  WriterFan& output,
+                                  std::atomic<double>& progress,
+                                  const std::atomic<bool>& abort)
+{
+    // Studied a pass ahead, so drafts run offline here too
+    auto options = static_cast<int> (settings.createRubberBandOptions());
+    options &= ~static_cast<int> (RubberBand::RubberBandStretcher::OptionProcessRealTime);
+
+    RubberBand::RubberBandStretcher stretcher (static_cast<size_t> (sampleRate),
+                                               static_cast<size_t> (numChannels),
+                                               static_cast<RubberBand::RubberBandStretcher::Options> (options));
+    stretcher.setTimeRatio (1.0);
+    stretcher.setPitchScale (pitchRatio);
+    stretcher.setMaxProcessSize (static_cast<size_t> (blockSize));
+
+    const juce::int64 totalSamples = spill != nullptr ? spill->length() : 0;
+    juce::AudioBuffer<float> inputBuffer (numChannels, blockSize);
+    juce::AudioBuffer<float> outputBuffer (numChannels, blockSize * 2);
+
+    // Study is the first half of this target's progress, processing the second
+    for (juce::int64 position = 0; position < totalSamples;) {
+        if (abort)
+            return juce::Result::fail (cancelledMessage);
+
+        const int n = static_cast<int> (juce::jmin<juce::int64> (blockSize, totalSamples - position));
+        spill->read (inputBuffer, position, n);
+        position += n;
+        stretcher.study (inputBuffer.getArrayOfReadPointers(), static_cast<size_t> (n), position >= totalSamples);
+        progress = 0.5 * static_cast<double> (position) / static_cast<double> (totalSamples);
+    }
+
+    auto retrieveAvailable = [&]() {
+        for (;;) {
+            const int available = juce::jmin (static_cast<int> (stretcher.available()), outputBuffer.getNumSamples());
+            if (available <= 0)
+                return true;
+
+            const auto retrieved = stretcher.retrieve (outputBuffer.getArrayOfWritePointers(), static_cast<size_t> (available));
+            if (! output.write (outputBuffer, 0, static_cast<int> (retrieved)))
+                return false;
+        }
+    };
+
+    for (juce::int64 position = 0; position < totalSamples;) {
+        if (abort)
+            return juce::Result::fail (cancelledMessage);
+
+        const int n = static_cast<int> (juce::jmin<juce::int64> (blockSize, totalSamples - position));
+        spill->read (inputBuffer, position, n);
+        position += n;
+        stretcher.process (inputBuffer.getArrayOfReadPointers(), static_cast<size_t> (n), position >= totalSamples);
+        if (! retrieveAvailable())
+            return output.failure();
+        progress = 0.5 + 0.5 * static_cast<double> (position) / static_cast<double> (totalSamples);
+    }
+
+    if (! output.finish())
+        return output.failure();
+
+    progress = 1.0;
+    return juce::Result::ok();
+}
+} // namespace detail
+
 //==============================================================================
 Exporter::Exporter()
 {
     _formatManager.registerBasicFormats();
+    _formatManager.registerFormat (new Wave64AudioFormat(), false);
 }
 
 Exporter::~Exporter() = default;
@@ -24,6 +703,14 @@ RubberBand::RubberBandStretcher::Options Exporter::ExportSettings::createRubberB
 
     // Configure based on quality preset
     switch (quality) {
+        case Quality::Draft:
+            // Streams in one pass, without studying the input first
+            options |= RBS::OptionProcessRealTime;
+            options |= RBS::OptionPitchHighSpeed;
+            options |= RBS::OptionWindowStandard;
+            options |= RBS::OptionThreadingNever;
+            break;
+
         case Quality::Standard:
             options |= RBS::OptionPitchHighSpeed;
             options |= RBS::OptionWindowStandard;
@@ -60,6 +747,16 @@ juce::Result Exporter::exportAudio (const juce::File& inputFile,
                                     float sourceFreq,
                                     float targetFreq,
                                     ProgressCallback progress)
+{
+    return exportAudio (inputFile, std::vector<OutputSpec> { { outputFile, settings.format, settings.bitDepth, settings.compressionLevel } }, settings, sourceFreq, targetFreq, std::move (progress));
+}
+
+juce::Result Exporter::exportAudio (const juce::File& inputFile,
+                                    const std::vector<OutputSpec>& outputs,
+                                    const ExportSettings& settings,
+                                    float sourceFreq,
+                                    float targetFreq,
+                                    ProgressCallback progress)
 {
     // Validate input
     if (! inputFile.existsAsFile())
@@ -68,6 +765,9 @@ juce::Result Exporter::exportAudio (const juce::File& inputFile,
     if (sourceFreq <= 0.0f || targetFreq <= 0.0f)
         return juce::Result::fail ("Invalid frequency values");
 
+    if (outputs.empty())
+        return juce::Result::fail ("Nothing to export");
+
     // Calculate pitch ratio
     const float pitchRatio = targetFreq / sourceFreq;
 
@@ -76,39 +776,39 @@ juce::Result Exporter::exportAudio (const juce::File& inputFile,
     if (reader == nullptr)
         return juce::Result::fail ("Could not open input file: " + inputFile.getFullPathName());
 
-    // Determine output sample rate
-    const double outputSampleRate = settings.enableUpsampling ? settings.upsampleRate : reader->sampleRate;
+    const int numChannels = static_cast<int> (reader->numChannels);
+    const juce::int64 totalSamples = reader->lengthInSamples;
 
-    // Get output format
-    juce::AudioFormat* outputFormat = nullptr;
-    if (settings.format == "wav")
-        outputFormat = _formatManager.findFormatForFileExtension (".wav");
-    else if (settings.format == "aiff")
-        outputFormat = _formatManager.findFormatForFileExtension (".aiff");
+    // Every stage stops once this is set, by cancelling or by a stage failing
+    std::atomic<bool> abort { false };
 
-    if (outputFormat == nullptr)
-        return juce::Result::fail ("Unsupported output format: " + settings.format);
+    // Open every output before doing any work. The render is shared, and
+    // each output converts it to its own rate, format and bit depth.
+    detail::WriterFan fan (numChannels, detail::blockSize, abort, progress);
+    for (const auto& spec : outputs) {
+        auto outputSettings = settings;
+        outputSettings.format = spec.format;
+        outputSettings.bitDepth = spec.bitDepth;
+        outputSettings.compressionLevel = spec.compressionLevel;
 
-    // Create output file
-    std::unique_ptr<juce::OutputStream> outputStream (outputFile.createOutputStream().release());
-    if (outputStream == nullptr)
-        return juce::Result::fail ("Could not create output file: " + outputFile.getFullPathName());
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+        const auto created = createWriter (spec.file, outputSettings, *reader, writer);
+        if (created.failed())
+            return created;
 
-    // Create writer options using builder pattern
-    auto writerOptions = juce::AudioFormatWriterOptions {}
-                             .withSampleRate (outputSampleRate)
-                             .withNumChannels (static_cast<int> (reader->numChannels))
-                             .withBitsPerSample (settings.bitDepth);
+        // Stretch at the file's rate, converting to the output rate afterwards
+        fan.add (spec.file, std::move (writer), reader->sampleRate);
+    }
+    fan.start();
 
-    // Create audio writer using modern API
-    auto writer = outputFormat->createWriterFor (outputStream, writerOptions);
-    if (writer == nullptr)
-        return juce::Result::fail ("Could not create audio writer");
+    // Drafts stream through in constant memory already, limit or not
+    if (settings.parallelSegments || (settings.memoryLimit > 0 && settings.quality != Quality::Draft))
+        return detail::exportSegments (_formatManager, inputFile, *reader, fan, settings, pitchRatio, progress);
 
     // Create Rubber Band stretcher
     auto rbOptions = settings.createRubberBandOptions();
     RubberBand::RubberBandStretcher stretcher (
-        static_cast<size_t> (outputSampleRate),
+        static_cast<size_t> (reader->sampleRate),
         static_cast<size_t> (reader->numChannels),
         rbOptions);
 
@@ -116,112 +816,598 @@ juce::Result Exporter::exportAudio (const juce::File& inputFile,
     stretcher.setPitchScale (pitchRatio);
 
     // Set large block size for offline processing
-    const int blockSize = 8192;
+    const int blockSize = detail::blockSize;
     stretcher.setMaxProcessSize (static_cast<size_t> (blockSize));
 
-    // Prepare buffers and channel pointers
-    juce::AudioBuffer<float> inputBuffer (static_cast<int> (reader->numChannels), blockSize);
-    juce::AudioBuffer<float> outputBuffer (static_cast<int> (reader->numChannels), blockSize * 2);
+    // Drafts skip the study pass, streaming through a realtime stretcher
+    const bool singlePass = settings.quality == Quality::Draft;
 
-    const juce::int64 totalSamples = reader->lengthInSamples;
-    std::vector<const float*> inputPtrs (reader->numChannels);
-    std::vector<float*> outputPtrs (reader->numChannels);
+    std::vector<const float*> inputPtrs (static_cast<size_t> (numChannels));
+    std::vector<float*> outputPtrs (static_cast<size_t> (numChannels));
 
-    // PASS 1: Study the entire input for optimal offline processing
-    juce::int64 samplesStudied = 0;
-    while (samplesStudied < totalSamples) {
-        // Check for cancellation during study pass
-        if (progress.shouldCancel && progress.shouldCancel())
-            return juce::Result::fail ("Export cancelled by user");
+    auto pointInput = [&] (const juce::AudioBuffer<float>& buffer) {
+        for (int ch = 0; ch < numChannels; ++ch)
+            inputPtrs[(size_t) ch] = buffer.getReadPointer (ch);
+    };
 
-        const int samplesToRead = static_cast<int> (juce::jmin<juce::int64> (blockSize, totalSamples - samplesStudied));
-        reader->read (&inputBuffer, 0, samplesToRead, samplesStudied, true, true);
+    auto pointOutput = [&] (juce::AudioBuffer<float>& buffer) {
+        for (int ch = 0; ch < numChannels; ++ch)
+            outputPtrs[(size_t) ch] = buffer.getWritePointer (ch);
+    };
 
-        // Prepare input pointers for study
-        for (size_t ch = 0; ch < reader->numChannels; ++ch)
-            inputPtrs[ch] = inputBuffer.getReadPointer (static_cast<int> (ch));
+    // Keep what the study pass decodes for the process pass. Anything fits in
+    // a temporary file, but that only beats reading the input again when the
+    // input is compressed. Compressed input goes to the cache when there is
+    // one, and comes straight back from it if it was decoded before.
+    std::unique_ptr<DecodeSpill> spill;
+    ExportCache::Entry cached;
+    if (! singlePass && _cache != nullptr && detail::isCompressed (*reader))
+        cached = _cache->find (inputFile, *reader);
+    if (cached.spill != nullptr)
+        spill = std::move (cached.spill);
+    else if (! singlePass)
+        spill = DecodeSpill::create (numChannels, totalSamples, detail::spillMemoryBudget, detail::isCompressed (*reader));
 
-        // Feed to study pass (set final=true on last block)
-        const bool isFinal = (samplesStudied + samplesToRead >= totalSamples);
-        stretcher.study (inputPtrs.data(), static_cast<size_t> (samplesToRead), isFinal);
+    StageClock decodeClock, stretchClock;
 
-        samplesStudied += samplesToRead;
+    auto cancelled = [&]() {
+        if (progress.shouldCancel && progress.shouldCancel())
+            abort = true;
+        return abort.load();
+    };
 
-        // Update progress (study is first 50%)
-        if (progress.onProgress) {
-            const double progressPercent = 0.5 * (static_cast<double> (samplesStudied) / static_cast<double> (totalSamples));
+    auto report = [&] (double progressPercent) {
+        if (progress.onProgress)
             progress.onProgress (progressPercent);
+        if (progress.onStageLoad)
+            progress.onStageLoad ({ decodeClock.load(), stretchClock.load(), fan.load() });
+        if (progress.onEncodeSpeed && fan.speed() > 0.0)
+            progress.onEncodeSpeed (fan.speed());
+    };
+
+    auto startStage = [&] (const juce::String& name, std::function<void()> work) {
+        auto stage = std::make_unique<StageThread> (name, abort, progress.onThreadStart, progress.onThreadEnd, std::move (work));
+        stage->startThread();
+        return stage;
+    };
+
+    auto resetClocks = [&]() {
+        decodeClock.reset();
+        stretchClock.reset();
+        fan.resetClocks();
+    };
+
+    // PASS 1: Study the entire input for optimal offline processing, with
+    // decoding running ahead on its own thread
+    resetClocks();
+    if (! singlePass) {
+        BlockQueue decoded (detail::pipelineDepth, numChannels, blockSize, abort);
+
+        auto decoder = startStage ("Export Decode", [&] {
+            for (juce::int64 position = 0; position < totalSamples;) {
+                auto* block = decoded.acquire();
+                if (block == nullptr)
+                    return;
+
+                block->numSamples = static_cast<int> (juce::jmin<juce::int64> (blockSize, totalSamples - position));
+                {
+                    const StageClock::Busy busy (decodeClock);
+                    if (cached.decoded) {
+                        spill->read (block->audio, position, block->numSamples);
+                    } else {
+                        reader->read (&block->audio, 0, block->numSamples, position, true, true);
+                        if (spill != nullptr && ! spill->write (block->audio, position, block->numSamples))
+                            spill.reset();
+                    }
+                }
+
+                position += block->numSamples;
+                block->last = position >= totalSamples;
+                decoded.push (block);
+            }
+        });
+
+        juce::int64 samplesStudied = 0;
+        while (samplesStudied < totalSamples && ! cancelled()) {
+            auto* block = decoded.pop();
+            if (block == nullptr)
+                break;
+
+            {
+                const StageClock::Busy busy (stretchClock);
+                pointInput (block->audio);
+                stretcher.study (inputPtrs.data(), static_cast<size_t> (block->numSamples), block->last);
+            }
+
+            samplesStudied += block->numSamples;
+            decoded.release (block);
+
+            // Study is first 50%
+            report (0.5 * (static_cast<double> (samplesStudied) / static_cast<double> (totalSamples)));
         }
+
+        decoder->waitForThreadToExit (-1);
     }
 
-    // PASS 2: Process the audio and generate output
-    // Need to re-open the reader since we've already read through it
-    reader.reset();
-    reader.reset (_formatManager.createReaderFor (inputFile));
-    if (reader == nullptr)
-        return juce::Result::fail ("Could not re-open input file for processing pass");
+    if (abort)
+        return fan.failure();
+
+    // PASS 2: Process the audio and generate output, from the spill if it
+    // held up, or else reading the input again from the start
+    if (! singlePass) {
+        if (spill != nullptr && ! spill->finishWriting())
+            spill.reset();
+        else if (spill != nullptr && _cache != nullptr && ! cached.decoded)
+            _cache->commit (cached.key, inputFile, *reader);
+
+        reader.reset();
+        if (spill == nullptr) {
+            reader.reset (_formatManager.createReaderFor (inputFile));
+            if (reader == nullptr)
+                return juce::Result::fail ("Could not re-open input file for processing pass");
+        }
+    }
+
+    resetClocks();
+    BlockQueue input (detail::pipelineDepth, numChannels, blockSize, abort);
+    juce::AudioBuffer<float> outputBuffer (numChannels, blockSize * 2);
+
+    auto decoder = startStage ("Export Decode", [&] {
+        for (juce::int64 position = 0; position < totalSamples;) {
+            auto* block = input.acquire();
+            if (block == nullptr)
+                return;
+
+            block->numSamples = static_cast<int> (juce::jmin<juce::int64> (blockSize, totalSamples - position));
+            {
+                const StageClock::Busy busy (decodeClock);
+                if (spill != nullptr)
+                    spill->read (block->audio, position, block->numSamples);
+                else
+                    reader->read (&block->audio, 0, block->numSamples, position, true, true);
+            }
+
+            position += block->numSamples;
+            block->last = position >= totalSamples;
+            input.push (block);
+        }
+    });
 
+    // Output still to drop from the start, and still to write
+    int discard = 0;
+    juce::int64 remainingOutput = totalSamples;
+    juce::AudioBuffer<float> silence;
+
+    // Hand on everything the stretcher has ready; false once aborted
+    auto retrieveAvailable = [&]() {
+        for (;;) {
+            const int available = static_cast<int> (stretcher.available());
+            if (available <= 0)
+                return true;
+
+            int retrieved = 0;
+            {
+                const StageClock::Busy busy (stretchClock);
+                pointOutput (outputBuffer);
+                const auto n = juce::jmin (available, outputBuffer.getNumSamples());
+                retrieved = static_cast<int> (stretcher.retrieve (outputPtrs.data(), static_cast<size_t> (n)));
+            }
+
+            // Drop the realtime stretcher's start delay, and anything past
+            // the input's length
+            const int skip = juce::jmin (discard, retrieved);
+            const int n = static_cast<int> (juce::jmin<juce::int64> (retrieved - skip, remainingOutput));
+            discard -= skip;
+            remainingOutput -= n;
+            if (! fan.write (outputBuffer, skip, n))
+                return false;
+        }
+    };
+
+    // A realtime stretcher wants silence ahead of the input, and starts its
+    // output late by the start delay
+    if (singlePass) {
+        silence.setSize (numChannels, blockSize);
+        silence.clear();
+        pointInput (silence);
+        for (int pad = static_cast<int> (stretcher.getPreferredStartPad()); pad > 0;) {
+            const int n = juce::jmin (pad, blockSize);
+            stretcher.process (inputPtrs.data(), static_cast<size_t> (n), false);
+            pad -= n;
+        }
+        discard = static_cast<int> (stretcher.getStartDelay());
+    }
+
+    const double passStart = singlePass ? 0.0 : 0.5;
     juce::int64 samplesProcessed = 0;
-    bool finalChunk = false;
+    bool finished = totalSamples <= 0;
+    bool failed = false;
 
-    while (samplesProcessed < totalSamples || stretcher.available() > 0) {
-        // Check for cancellation during process pass
-        if (progress.shouldCancel && progress.shouldCancel())
-            return juce::Result::fail ("Export cancelled by user");
+    while (! finished && ! cancelled()) {
+        auto* block = input.pop();
+        if (block == nullptr)
+            break;
 
-        // Read input chunk if not at end
-        if (samplesProcessed < totalSamples) {
-            const int samplesToRead = static_cast<int> (juce::jmin<juce::int64> (blockSize, totalSamples - samplesProcessed));
-            reader->read (&inputBuffer, 0, samplesToRead, samplesProcessed, true, true);
+        finished = block->last;
+        {
+            const StageClock::Busy busy (stretchClock);
+            pointInput (block->audio);
+            stretcher.process (inputPtrs.data(), static_cast<size_t> (block->numSamples), block->last && ! singlePass);
+        }
+
+        samplesProcessed += block->numSamples;
+        input.release (block);
 
-            // Prepare input pointers
-            for (size_t ch = 0; ch < reader->numChannels; ++ch)
-                inputPtrs[ch] = inputBuffer.getReadPointer (static_cast<int> (ch));
+        if (! retrieveAvailable()) {
+            failed = true;
+            break;
+        }
 
-            // Process with stretcher
-            finalChunk = (samplesProcessed + samplesToRead >= totalSamples);
-            stretcher.process (inputPtrs.data(), static_cast<size_t> (samplesToRead), finalChunk);
+        // Process is second 50%, or all of a single pass
+        report (passStart + (1.0 - passStart) * (static_cast<double> (samplesProcessed) / static_cast<double> (totalSamples)));
+    }
 
-            samplesProcessed += samplesToRead;
+    // Push silence through a realtime stretcher until the end of the input
+    // has come out the other side. Its output trails the input by about the
+    // start delay, so flushing far beyond that means it has stalled.
+    if (singlePass && finished && ! failed) {
+        pointInput (silence);
+        auto flushLimit = remainingOutput + discard + static_cast<juce::int64> (stretcher.getStartDelay())
+                          + static_cast<juce::int64> (detail::draftFlushMarginBlocks) * blockSize;
+        while (remainingOutput > 0 && flushLimit > 0 && ! cancelled()) {
+            stretcher.process (inputPtrs.data(), static_cast<size_t> (blockSize), false);
+            flushLimit -= blockSize;
+            if (! retrieveAvailable()) {
+                failed = true;
+                break;
+            }
         }
+    }
 
-        // Retrieve processed audio
-        int available = static_cast<int> (stretcher.available());
-        if (available > 0) {
-            available = juce::jmin (available, outputBuffer.getNumSamples());
+    // A short draft is never a success; stop the outputs rather than finish them
+    const bool stalled = singlePass && finished && ! failed && remainingOutput > 0 && ! cancelled();
+    const bool complete = finished && ! failed && ! stalled;
+    if (! complete)
+        abort = true;
 
-            // Prepare output pointers
-            for (size_t ch = 0; ch < reader->numChannels; ++ch)
-                outputPtrs[ch] = outputBuffer.getWritePointer (static_cast<int> (ch));
+    const bool written = complete && fan.finish();
+    decoder->waitForThreadToExit (-1);
 
-            const size_t retrieved = stretcher.retrieve (outputPtrs.data(), static_cast<size_t> (available));
+    if (stalled)
+        return juce::Result::fail ("The export stopped " + juce::String (remainingOutput) + " samples short of the input length");
+    if (! written)
+        return fan.failure();
 
-            // Write to output file
-            if (retrieved > 0)
-                writer->writeFromAudioSampleBuffer (outputBuffer, 0, static_cast<int> (retrieved));
+    return juce::Result::ok();
+}
+
+//==============================================================================
+juce::Result Exporter::exportTargets (const juce::File& inputFile,
+                                      const std::vector<Target>& targets,
+                                      float sourceFreq,
+                                      ProgressCallback progress)
+{
+    if (targets.empty())
+        return juce::Result::fail ("Nothing to export");
+
+    // A single target gets the pipelined exporter to itself. Under a memory
+    // limit the decode can't be held for every target, so each takes a turn.
+    const bool limited = std::any_of (targets.begin(), targets.end(), [] (const Target& t) { return t.settings.memoryLimit > 0; });
+    if (targets.size() == 1 || limited) {
+        const auto numTargets = static_cast<double> (targets.size());
+        for (size_t i = 0; i < targets.size(); ++i) {
+            auto turn = progress;
+            if (progress.onProgress)
+                turn.onProgress = [&progress, i, numTargets] (double p) { progress.onProgress ((static_cast<double> (i) + p) / numTargets); };
+
+            const auto& target = targets[i];
+            const auto result = exportAudio (inputFile, target.outputFile, target.settings, sourceFreq, target.targetFreq, std::move (turn));
+            if (result.failed())
+                return result;
         }
+        return juce::Result::ok();
+    }
+
+    if (! inputFile.existsAsFile())
+        return juce::Result::fail ("Input file does not exist");
+
+    if (sourceFreq <= 0.0f)
+        return juce::Result::fail ("Invalid frequency values");
+    for (const auto& target : targets)
+        if (target.targetFreq <= 0.0f)
+            return juce::Result::fail ("Invalid frequency values");
+
+    std::unique_ptr<juce::AudioFormatReader> reader (_formatManager.createReaderFor (inputFile));
+    if (reader == nullptr)
+        return juce::Result::fail ("Could not open input file: " + inputFile.getFullPathName());
+
+    const int numChannels = static_cast<int> (reader->numChannels);
+    const double sampleRate = reader->sampleRate;
+    const juce::int64 totalSamples = reader->lengthInSamples;
+
+    // Every target stops once this is set, by cancelling or by one failing
+    std::atomic<bool> abort { false };
+
+    // Open every output first, so a bad one fails before any work is done
+    struct Output {
+        std::unique_ptr<detail::WriterFan> writer;
+        std::atomic<double> progress { 0.0 };
+        juce::Result result { juce::Result::ok() };
+    };
+
+    std::vector<std::unique_ptr<Output>> outputs;
+    for (const auto& target : targets) {
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+        const auto created = createWriter (target.outputFile, target.settings, *reader, writer);
+        if (created.failed())
+            return created;
+
+        auto output = std::make_unique<Output>();
+        output->writer = std::make_unique<detail::WriterFan> (numChannels, detail::blockSize, abort, progress);
+        output->writer->add (target.outputFile, std::move (writer), sampleRate);
+        outputs.push_back (std::move (output));
+    }
+
+    // Decode once, or not at all if it's cached; every stretcher reads its
+    // input back from here
+    ExportCache::Entry cached;
+    if (_cache != nullptr && detail::isCompressed (*reader))
+        cached = _cache->find (inputFile, *reader);
+
+    auto spill = cached.spill != nullptr ? std::move (cached.spill)
+                                         : DecodeSpill::create (numChannels, totalSamples, detail::spillMemoryBudget, true);
+    if (spill == nullptr && totalSamples > 0)
+        return juce::Result::fail ("Could not make room for the decoded input");
+
+    juce::AudioBuffer<float> buffer (numChannels, detail::blockSize);
+    for (juce::int64 position = cached.decoded ? totalSamples : 0; position < totalSamples;) {
+        if (progress.shouldCancel && progress.shouldCancel())
+            return juce::Result::fail ("Export cancelled by user");
+
+        const int n = static_cast<int> (juce::jmin<juce::int64> (detail::blockSize, totalSamples - position));
+        reader->read (&buffer, 0, n, position, true, true);
+        if (! spill->write (buffer, position, n))
+            return juce::Result::fail ("Could not hold the decoded input");
+        position += n;
+
+        if (progress.onProgress)
+            progress.onProgress (detail::fanOutDecodeShare * static_cast<double> (position) / static_cast<double> (totalSamples));
+    }
+
+    if (spill != nullptr && ! spill->finishWriting())
+        return juce::Result::fail ("Could not hold the decoded input");
+    if (_cache != nullptr && ! cached.decoded)
+        _cache->commit (cached.key, inputFile, *reader);
+    reader.reset();
+
+    // Then stretch for every target at once, each on its own thread
+    std::vector<std::unique_ptr<StageThread>> stages;
+    for (size_t i = 0; i < targets.size(); ++i) {
+        auto* output = outputs[i].get();
+        const auto* settings = &targets[i].settings;
+        const float pitchRatio = targets[i].targetFreq / sourceFreq;
+
+        stages.push_back (std::make_unique<StageThread> ("Export Target", abort, progress.onThreadStart, progress.onThreadEnd, [&, output, settings, pitchRatio] {
+            output->result = detail::renderTarget (spill.get(), sampleRate, numChannels, *settings, pitchRatio,
+                                                   *output->writer, output->progress, abort);
+            if (output->result.failed())
+                abort = true;
+        }));
+        output->writer->start();
+        stages.back()->startThread();
+    }
+
+    auto running = [&]() {
+        return std::any_of (stages.begin(), stages.end(), [] (auto& stage) { return stage->isThreadRunning(); });
+    };
+
+    while (running()) {
+        if (progress.shouldCancel && progress.shouldCancel())
+            abort = true;
 
-        // Update progress (process is second 50%)
         if (progress.onProgress) {
-            const double progressPercent = 0.5 + 0.5 * (static_cast<double> (samplesProcessed) / static_cast<double> (totalSamples));
-            progress.onProgress (progressPercent);
+            double done = 0.0;
+            for (auto& output : outputs)
+                done += output->progress.load();
+            progress.onProgress (detail::fanOutDecodeShare + (1.0 - detail::fanOutDecodeShare) * done / static_cast<double> (outputs.size()));
         }
 
-        // Break if we've processed everything and stretcher is empty
-        if (finalChunk && stretcher.available() == 0)
-            break;
+        if (progress.onEncodeSpeed) {
+            double slowest = 0.0;
+            for (auto& output : outputs) {
+                const auto speed = output->writer->speed();
+                if (speed > 0.0)
+                    slowest = slowest > 0.0 ? juce::jmin (slowest, speed) : speed;
+            }
+            if (slowest > 0.0)
+                progress.onEncodeSpeed (slowest);
+        }
+
+        juce::Thread::sleep (detail::fanOutPollMs);
+    }
+
+    for (size_t i = 0; i < targets.size(); ++i)
+        if (outputs[i]->result.failed() && outputs[i]->result.getErrorMessage() != detail::cancelledMessage)
+            return juce::Result::fail (targets[i].outputFile.getFileName() + ": " + outputs[i]->result.getErrorMessage());
+
+    if (abort)
+        return juce::Result::fail ("Export cancelled by user");
+
+    return juce::Result::ok();
+}
+
+//==============================================================================
+juce::Result Exporter::createWriter (const juce::File& outputFile,
+                                     const ExportSettings& settings,
+                                     const juce::AudioFormatReader& reader,
+                                     std::unique_ptr<juce::AudioFormatWriter>& writer)
+{
+    // Determine output sample rate
+    const double outputSampleRate = settings.enableUpsampling ? settings.upsampleRate : reader.sampleRate;
+
+    // Get output format. WAV switches itself to RF64 once past 4 GB, and
+    // Wave64 has no limit to begin with.
+    juce::AudioFormat* outputFormat = nullptr;
+    if (settings.format == "wav")
+        outputFormat = _formatManager.findFormatForFileExtension (".wav");
+    else if (settings.format == "aiff")
+        outputFormat = _formatManager.findFormatForFileExtension (".aiff");
+    else if (settings.format == "w64")
+        outputFormat = _formatManager.findFormatForFileExtension (".w64");
+    else if (settings.format == "flac")
+        outputFormat = _formatManager.findFormatForFileExtension (".flac");
+    else if (settings.format == "ogg")
+        outputFormat = _formatManager.findFormatForFileExtension (".ogg");
+
+    if (outputFormat == nullptr)
+        return juce::Result::fail ("Unsupported output format: " + settings.format);
+
+    // AIFF can't, so fail now rather than hours in
+    const auto outputBytes = static_cast<double> (reader.lengthInSamples) * (outputSampleRate / reader.sampleRate)
+                             * reader.numChannels * (settings.bitDepth / 8);
+    if (settings.format == "aiff" && outputBytes > static_cast<double> (detail::aiffMaxBytes))
+        return juce::Result::fail ("AIFF files can't hold more than 4 GB of audio. Export as WAV or Wave64 instead.");
+
+    // Create output file
+    std::unique_ptr<juce::OutputStream> outputStream (outputFile.createOutputStream (detail::outputBufferBytes).release());
+    if (outputStream == nullptr)
+        return juce::Result::fail ("Could not create output file: " + outputFile.getFullPathName());
+
+    // FLAC holds integers up to 24 bits, so 32-bit float is rounded down to that
+    const int bitDepth = settings.format == "flac" ? juce::jmin (24, settings.bitDepth) : settings.bitDepth;
+
+    // Compression for the formats that have it, encoded on the output's own thread
+    auto quality = settings.compressionLevel >= 0 ? settings.compressionLevel : defaultCompressionLevel (settings.format);
+    quality = juce::jlimit (0, juce::jmax (0, outputFormat->getQualityOptions().size() - 1), quality);
+
+    // Create writer options using builder pattern
+    auto writerOptions = juce::AudioFormatWriterOptions {}
+                             .withSampleRate (outputSampleRate)
+                             .withNumChannels (static_cast<int> (reader.numChannels))
+                             .withBitsPerSample (bitDepth)
+                             .withQualityOptionIndex (quality);
+
+    // Create audio writer using modern API
+    writer = outputFormat->createWriterFor (outputStream, writerOptions);
+    if (writer == nullptr)
+        return juce::Result::fail ("Could not create audio writer");
+
+    return juce::Result::ok();
+}
+
+//==============================================================================
+juce::Result Exporter::renderRange (juce::AudioFormatReader& reader,
+                                    juce::int64 startSample,
+                                    int numSamples,
+                                    int padding,
+                                    const ExportSettings& settings,
+                                    float pitchRatio,
+                                    juce::AudioBuffer<float>& output,
+                                    const std::function<bool()>& shouldCancel)
+{
+    using RBS = RubberBand::RubberBandStretcher;
+
+    const auto first = juce::jmax<juce::int64> (0, startSample - padding);
+    const auto last = juce::jmin<juce::int64> (reader.lengthInSamples, startSample + numSamples + padding);
+    if (numSamples <= 0 || startSample < first || startSample + numSamples > last)
+        return juce::Result::fail ("Range is outside of the input");
+
+    const int numChannels = static_cast<int> (reader.numChannels);
+    const int length = static_cast<int> (last - first);
+
+    juce::AudioBuffer<float> input (numChannels, length);
+    if (! reader.read (&input, 0, length, first, true, true))
+        return juce::Result::fail ("Could not read input range");
+
+    auto options = static_cast<int> (settings.createRubberBandOptions());
+    options &= ~static_cast<int> (RBS::OptionThreadingAlways | RBS::OptionProcessRealTime);
+    options |= RBS::OptionThreadingNever;
+
+    RBS stretcher (static_cast<size_t> (reader.sampleRate),
+                   static_cast<size_t> (numChannels),
+                   static_cast<RBS::Options> (options));
+    stretcher.setTimeRatio (1.0);
+    stretcher.setPitchScale (pitchRatio);
+
+    const int blockSize = 8192;
+    stretcher.setMaxProcessSize (static_cast<size_t> (blockSize));
+
+    juce::AudioBuffer<float> rendered (numChannels, length);
+    rendered.clear();
+
+    std::vector<const float*> inputPtrs (static_cast<size_t> (numChannels));
+    std::vector<float*> outputPtrs (static_cast<size_t> (numChannels));
+
+    auto pointInput = [&] (int offset) {
+        for (int ch = 0; ch < numChannels; ++ch)
+            inputPtrs[(size_t) ch] = input.getReadPointer (ch, offset);
+    };
+
+    for (int pos = 0; pos < length; pos += blockSize) {
+        if (shouldCancel && shouldCancel())
+            return juce::Result::fail ("Render cancelled");
+
+        const int n = juce::jmin (blockSize, length - pos);
+        pointInput (pos);
+        stretcher.study (inputPtrs.data(), static_cast<size_t> (n), pos + n >= length);
     }
 
+    int written = 0;
+    auto retrieveAvailable = [&]() {
+        for (;;) {
+            const int available = static_cast<int> (stretcher.available());
+            if (available <= 0)
+                break;
+
+            // Offline output matches the input length; anything past it is discarded
+            const int n = juce::jmin (available, length - written);
+            if (n <= 0) {
+                juce::AudioBuffer<float> discard (numChannels, available);
+                stretcher.retrieve (discard.getArrayOfWritePointers(), static_cast<size_t> (available));
+                break;
+            }
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                outputPtrs[(size_t) ch] = rendered.getWritePointer (ch, written);
+            written += static_cast<int> (stretcher.retrieve (outputPtrs.data(), static_cast<size_t> (n)));
+        }
+    };
+
+    for (int pos = 0; pos < length; pos += blockSize) {
+        if (shouldCancel && shouldCancel())
+            return juce::Result::fail ("Render cancelled");
+
+        const int n = juce::jmin (blockSize, length - pos);
+        pointInput (pos);
+        stretcher.process (inputPtrs.data(), static_cast<size_t> (n), pos + n >= length);
+        retrieveAvailable();
+    }
+
+    output.setSize (numChannels, numSamples, false, false, true);
+    const int offset = static_cast<int> (startSample - first);
+    for (int ch = 0; ch < numChannels; ++ch)
+        output.copyFrom (ch, 0, rendered, ch, offset, numSamples);
+
     return juce::Result::ok();
 }
 
 //==============================================================================
+int Exporter::defaultCompressionLevel (const juce::String& format)
+{
+    if (format == "flac")
+        return detail::flacDefaultLevel;
+    if (format == "ogg")
+        return detail::oggDefaultQuality;
+    return 0;
+}
+
 Exporter::ExportSettings Exporter::preset (Quality quality)
 {
     ExportSettings settings;
     settings.quality = quality;
 
     switch (quality) {
+        case Quality::Draft:
         case Quality::Standard:
             settings.enableUpsampling = false;
             settings.bitDepth = 16;
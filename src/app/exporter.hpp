@@ -4,6 +4,7 @@
 #pragma once
 
 #include <functional>
+#include <vector>
 #include <juce_audio_formats/juce_audio_formats.h>
 #include <juce_core/juce_core.h>
 #include <rubberband/RubberBandStretcher.h>
@@ -11,6 +12,8 @@
 namespace retuner {
 namespace app {
 
+class ExportCache;
+
 /**
  * High-quality audio exporter for offline frequency conversion.
  * Processes audio files with maximum quality settings using Rubber Band.
@@ -19,6 +22,7 @@ class Exporter {
 public:
     /** Quality preset options for export */
     enum class Quality {
+        Draft,    ///< Single pass through a realtime stretcher, for quick previews
         Standard, ///< Fast processing with good quality
         High,     ///< Balanced quality and speed
         Maximum   ///< Best quality, slower processing
@@ -32,14 +36,72 @@ public:
         int bitDepth = 24;
         juce::String format = "wav";
 
+        /**
+         * For FLAC the compression level, 0 to 8; for Ogg Vorbis an index
+         * into its bitrates, lowest first. -1 picks the format's usual choice.
+         */
+        int compressionLevel = -1;
+
+        /**
+         * Split the input into overlapping segments that are stretched side
+         * by side and crossfaded back together. Output is the same whatever
+         * the number of threads.
+         */
+        bool parallelSegments = false;
+        double segmentSeconds = 30.0;
+        int numThreads = 0; ///< Threads stretching segments; 0 uses every core
+
+        /**
+         * Most memory in bytes the export may hold for audio, or 0 for no
+         * limit. With a limit the input is stretched in windows as for
+         * parallelSegments, with fewer threads and shorter windows as needed
+         * to fit, so memory stays flat however long the input is.
+         */
+        juce::int64 memoryLimit = 0;
+
         /** Creates optimal Rubber Band options based on quality setting */
         RubberBand::RubberBandStretcher::Options createRubberBandOptions() const;
     };
 
+    /** One file written from a render, in its own format and bit depth */
+    struct OutputSpec {
+        juce::File file;
+        juce::String format = "wav";
+        int bitDepth = 24;
+        int compressionLevel = -1;
+    };
+
+    /** One output of a multi-target export */
+    struct Target {
+        juce::File outputFile;
+        float targetFreq = 432.0f;
+        ExportSettings settings;
+    };
+
+    /** Fraction of the current pass each export stage has spent working rather than waiting */
+    struct StageLoad {
+        double decode = 0.0;
+        double stretch = 0.0;
+        double write = 0.0;
+    };
+
     /** Progress callback interface for export operations */
     struct ProgressCallback {
         std::function<void (double progress)> onProgress;
         std::function<bool()> shouldCancel;
+
+        /** Reported alongside onProgress */
+        std::function<void (const StageLoad& load)> onStageLoad;
+
+        /** Times real time the slowest output encodes at, counting only time spent encoding; reported alongside onProgress */
+        std::function<void (double speed)> onEncodeSpeed;
+
+        /** Bytes of audio held by a windowed export, reported alongside onProgress */
+        std::function<void (juce::int64 bytes)> onMemoryUsage;
+
+        /** Called on each worker thread the export uses as it starts, and before it ends */
+        std::function<void()> onThreadStart;
+        std::function<void()> onThreadEnd;
     };
 
     Exporter();
@@ -47,7 +109,16 @@ public:
 
     /**
      * Export audio file with frequency conversion.
-     * 
+     *
+     * Decoding, stretching and writing run on separate threads joined by
+     * bounded queues, so reading and encoding overlap the stretcher. The
+     * stretcher runs on the calling thread, which is also where the callbacks
+     * in @p progress are made, apart from the thread start and end ones.
+     *
+     * With ExportSettings::parallelSegments the stretching is instead spread
+     * over a thread pool, one segment per job, and written out in order. So
+     * is a memoryLimit, unless the quality is Draft, which streams anyway.
+     *
      * @param inputFile Source audio file to process
      * @param outputFile Destination file for exported audio
      * @param settings Export quality and format settings
@@ -63,11 +134,93 @@ public:
                               float targetFreq,
                               ProgressCallback progress = {});
 
+    /**
+     * Export audio file with frequency conversion to several files at once.
+     *
+     * The audio is stretched once and handed to every output, each writing on
+     * a thread of its own with its own format and bit depth. The format and
+     * bit depth in @p settings are ignored in favour of each output's.
+     *
+     * @param outputs Files to write, with their formats and bit depths
+     * @return Result indicating success, or the first output's error
+     */
+    juce::Result exportAudio (const juce::File& inputFile,
+                              const std::vector<OutputSpec>& outputs,
+                              const ExportSettings& settings,
+                              float sourceFreq,
+                              float targetFreq,
+                              ProgressCallback progress = {});
+
+    /**
+     * Export one input at several target frequencies or formats in one go.
+     *
+     * The input is decoded once, then every target is studied, stretched and
+     * written on a thread of its own, so parallelSegments only applies when
+     * there's a single target, which is passed straight to exportAudio().
+     * With a memoryLimit the targets go through exportAudio() one by one.
+     * Progress is reported from the calling thread.
+     *
+     * @param inputFile Source audio file to process
+     * @param targets Output file, target A4 frequency and settings for each output
+     * @param sourceFreq Source A4 frequency (e.g. 440Hz)
+     * @param progress Optional progress callback; onStageLoad is not used here
+     * @return Result indicating success, or the first target's error
+     */
+    juce::Result exportTargets (const juce::File& inputFile,
+                                const std::vector<Target>& targets,
+                                float sourceFreq,
+                                ProgressCallback progress = {});
+
+    /** Formats the exporter reads and writes; register more to export from them too. */
+    juce::AudioFormatManager& formatManager() noexcept { return _formatManager; }
+
     /** Get preset settings for a given quality level */
     static ExportSettings preset (Quality quality);
 
+    /** Compression level used for @p format when ExportSettings::compressionLevel is -1. */
+    static int defaultCompressionLevel (const juce::String& format);
+
+    /**
+     * Keep decoded compressed input in @p cache, and study from it when the
+     * same audio is exported again. Not owned; nullptr to stop caching.
+     */
+    void setCache (ExportCache* cache) noexcept { _cache = cache; }
+
+    /**
+     * Render part of a file through the offline stretcher at the reader's sample rate.
+     *
+     * Up to @p padding samples either side of the range are rendered for context and
+     * discarded, so independently rendered ranges line up with each other. The
+     * stretcher always runs single-threaded so several ranges can render side by side.
+     *
+     * @param reader Reader to pull input from; not shared with other threads
+     * @param startSample First sample of the range
+     * @param numSamples Length of the range
+     * @param padding Context rendered on each side of the range
+     * @param settings Quality settings used to configure the stretcher
+     * @param pitchRatio Target/source frequency ratio
+     * @param output Receives the rendered range, resized to fit
+     * @param shouldCancel Optional; polled between blocks
+     * @return Result indicating success or error message
+     */
+    static juce::Result renderRange (juce::AudioFormatReader& reader,
+                                     juce::int64 startSample,
+                                     int numSamples,
+                                     int padding,
+                                     const ExportSettings& settings,
+                                     float pitchRatio,
+                                     juce::AudioBuffer<float>& output,
+                                     const std::function<bool()>& shouldCancel = {});
+
 private:
     juce::AudioFormatManager _formatManager;
+    ExportCache* _cache { nullptr };
+
+    /** Open a writer for @p outputFile matching the settings and the reader's channels. */
+    juce::Result createWriter (const juce::File& outputFile,
+                               const ExportSettings& settings,
+                               const juce::AudioFormatReader& reader,
+                               std::unique_ptr<juce::AudioFormatWriter>& writer);
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Exporter)
 };
@@ -0,0 +1,113 @@
+// Copyright (c) 2025 Kushview, LLC
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "exportpipeline.hpp"
+
+namespace retuner {
+namespace app {
+
+namespace detail {
+/** Longest a stage waits before checking the abort flag again */
+static constexpr int stageWaitMs = 10;
+} // namespace detail
+
+BlockQueue::BlockQueue (int numBlocks, int numChannels, int blockSize, const std::atomic<bool>& abort)
+    : _abort (abort),
+      _filledFifo (numBlocks + 1),
+      _emptyFifo (numBlocks + 1),
+      _filled ((size_t) numBlocks + 1),
+      _empty ((size_t) numBlocks + 1)
+{
+    for (int i = 0; i < numBlocks; ++i) {
+        auto block = std::make_unique<Block>();
+        block->audio.setSize (numChannels, blockSize);
+        add (_emptyFifo, _empty, block.get());
+        _blocks.push_back (std::move (block));
+    }
+}
+
+void BlockQueue::add (juce::AbstractFifo& fifo, std::vector<Block*>& slots, Block* block)
+{
+    const auto scope = fifo.write (1);
+    if (scope.blockSize1 > 0)
+        slots[(size_t) scope.startIndex1] = block;
+    else if (scope.blockSize2 > 0)
+        slots[(size_t) scope.startIndex2] = block;
+}
+
+BlockQueue::Block* BlockQueue::take (juce::AbstractFifo& fifo, std::vector<Block*>& slots)
+{
+    Block* block = nullptr;
+    const auto scope = fifo.read (1);
+    if (scope.blockSize1 > 0)
+        block = slots[(size_t) scope.startIndex1];
+    else if (scope.blockSize2 > 0)
+        block = slots[(size_t) scope.startIndex2];
+    return block;
+}
+
+BlockQueue::Block* BlockQueue::wait (juce::AbstractFifo& fifo, std::vector<Block*>& slots, juce::WaitableEvent& event)
+{
+    while (! _abort.load()) {
+        if (auto* block = take (fifo, slots))
+            return block;
+        event.wait (detail::stageWaitMs);
+    }
+    return nullptr;
+}
+
+BlockQueue::Block* BlockQueue::acquire()
+{
+    auto* block = wait (_emptyFifo, _empty, _emptyEvent);
+    if (block != nullptr) {
+        block->numSamples = 0;
+        block->last = false;
+    }
+    return block;
+}
+
+void BlockQueue::push (Block* block)
+{
+    add (_filledFifo, _filled, block);
+    _filledEvent.signal();
+}
+
+BlockQueue::Block* BlockQueue::pop()
+{
+    return wait (_filledFifo, _filled, _filledEvent);
+}
+
+void BlockQueue::release (Block* block)
+{
+    add (_emptyFifo, _empty, block);
+    _emptyEvent.signal();
+}
+
+//==============================================================================
+StageThread::StageThread (const juce::String& name, std::atomic<bool>& abort, std::function<void()> onStart, std::function<void()> onEnd, std::function<void()> work)
+    : juce::Thread (name),
+      _abort (abort),
+      _onStart (std::move (onStart)),
+      _onEnd (std::move (onEnd)),
+      _work (std::move (work))
+{
+}
+
+StageThread::~StageThread()
+{
+    if (isThreadRunning())
+        _abort = true;
+    waitForThreadToExit (-1);
+}
+
+void StageThread::run()
+{
+    if (_onStart)
+        _onStart();
+    _work();
+    if (_onEnd)
+        _onEnd();
+}
+
+} // namespace app
+} // namespace retuner
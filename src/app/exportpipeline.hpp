@@ -0,0 +1,121 @@
+// Copyright (c) 2025 Kushview, LLC
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <functional>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+
+namespace retuner {
+namespace app {
+
+/**
+ * Blocks of audio handed from one export stage to the next.
+ *
+ * A fixed pool of blocks circulates between one producer thread and one
+ * consumer thread through two lock-free queues: filled blocks go forward and
+ * empty ones come back. A producer that has every block in flight waits for
+ * one to come back, so a fast stage can't run away from a slow one.
+ *
+ * Waits give up once the shared abort flag is set, which is how both
+ * cancelling and a failing stage stop the others.
+ */
+class BlockQueue {
+public:
+    struct Block {
+        juce::AudioBuffer<float> audio;
+        int numSamples { 0 };
+        bool last { false }; // nothing follows this block
+    };
+
+    BlockQueue (int numBlocks, int numChannels, int blockSize, const std::atomic<bool>& abort);
+
+    /** Producer: an empty block to fill. Waits while all are in flight; nullptr once aborted. */
+    Block* acquire();
+
+    /** Producer: hand a filled block to the consumer. */
+    void push (Block* block);
+
+    /** Consumer: the next filled block. Waits for one; nullptr once aborted. */
+    Block* pop();
+
+    /** Consumer: return a block once done with it. */
+    void release (Block* block);
+
+private:
+    std::vector<std::unique_ptr<Block>> _blocks;
+    const std::atomic<bool>& _abort;
+
+    juce::AbstractFifo _filledFifo, _emptyFifo;
+    std::vector<Block*> _filled, _empty;
+    juce::WaitableEvent _filledEvent, _emptyEvent;
+
+    static void add (juce::AbstractFifo& fifo, std::vector<Block*>& slots, Block* block);
+    static Block* take (juce::AbstractFifo& fifo, std::vector<Block*>& slots);
+    Block* wait (juce::AbstractFifo& fifo, std::vector<Block*>& slots, juce::WaitableEvent& event);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BlockQueue)
+};
+
+//==============================================================================
+/** Time a stage spends working, as opposed to waiting on its neighbours. */
+class StageClock {
+public:
+    /** Counts the time until it goes out of scope as busy. */
+    class Busy {
+    public:
+        explicit Busy (StageClock& clock) noexcept
+            : _clock (clock), _start (juce::Time::getHighResolutionTicks()) {}
+        ~Busy() { _clock._busy += juce::Time::getHighResolutionTicks() - _start; }
+
+    private:
+        StageClock& _clock;
+        const juce::int64 _start;
+    };
+
+    /** Start counting from now. */
+    void reset() noexcept
+    {
+        _busy = 0;
+        _start = juce::Time::getHighResolutionTicks();
+    }
+
+    /** Fraction of the time since reset() spent busy. */
+    double load() const noexcept
+    {
+        const auto elapsed = juce::Time::getHighResolutionTicks() - _start.load();
+        return elapsed > 0 ? juce::jlimit (0.0, 1.0, static_cast<double> (_busy.load()) / static_cast<double> (elapsed)) : 0.0;
+    }
+
+    /** Time spent busy since reset(). */
+    double busySeconds() const noexcept { return juce::Time::highResolutionTicksToSeconds (_busy.load()); }
+
+private:
+    std::atomic<juce::int64> _busy { 0 };
+    std::atomic<juce::int64> _start { 0 };
+};
+
+//==============================================================================
+/**
+ * Runs one export stage on its own thread.
+ *
+ * Destroying it sets the abort flag before waiting for the thread, so an
+ * early return on the calling thread can't leave a stage waiting forever.
+ */
+class StageThread : public juce::Thread {
+public:
+    StageThread (const juce::String& name, std::atomic<bool>& abort, std::function<void()> onStart, std::function<void()> onEnd, std::function<void()> work);
+    ~StageThread() override;
+
+    void run() override;
+
+private:
+    std::atomic<bool>& _abort;
+    std::function<void()> _onStart, _onEnd, _work;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StageThread)
+};
+
+} // namespace app
+} // namespace retuner
@@ -2,24 +2,33 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "exportthread.hpp"
+#include "application.hpp"
 
 namespace retuner {
 namespace app {
 
+namespace detail {
+/** Disk space kept for decoded input between exports */
+static constexpr juce::int64 exportCacheBudget = juce::int64 (4) << 30;
+} // namespace detail
+
 ExportThread::ExportThread (const juce::File& inputFile,
-                            const juce::File& outputFile,
-                            const Exporter::ExportSettings& settings,
+                            std::vector<Exporter::Target> targets,
                             float sourceFreq,
-                            float targetFreq)
+                            ThreadPolicy& threadPolicy)
     : juce::ThreadWithProgressWindow ("Exporting Audio...", true, true),
       _inputFile (inputFile),
-      _outputFile (outputFile),
-      _settings (settings),
+      _targets (std::move (targets)),
       _sourceFreq (sourceFreq),
-      _targetFreq (targetFreq),
+      _threadPolicy (threadPolicy),
       _result (juce::Result::ok())
 {
     setStatusMessage ("Preparing export...");
+
+    if (auto* props = Application::settingsRef().getUserSettings()) {
+        _cache = std::make_unique<ExportCache> (props->getFile().getParentDirectory().getChildFile ("ExportCache"), detail::exportCacheBudget);
+        _exporter.setCache (_cache.get());
+    }
 }
 
 ExportThread::~ExportThread() = default;
@@ -29,35 +38,72 @@ void ExportThread::run()
     // Set up progress callback
     Exporter::ProgressCallback progress;
 
-    progress.onProgress = [this] (double p) {
+    juce::String phase, stages, memory, speed;
+
+    // The phase, then whatever the export says about how it's going
+    auto showStatus = [&]() {
+        juce::StringArray details { stages, memory, speed };
+        details.removeEmptyStrings();
+        setStatusMessage (details.isEmpty() ? phase : phase + " (" + details.joinIntoString (", ") + ")");
+    };
+
+    progress.onProgress = [this, &phase, &showStatus] (double p) {
         setProgress (p);
 
         // Update status message based on phase
-        if (p < 0.5)
-            setStatusMessage ("Analyzing audio (study phase)...");
+        if (_targets.size() > 1)
+            phase = "Processing audio for " + juce::String ((int) _targets.size()) + " targets...";
+        else if (_targets.front().settings.quality == Exporter::Quality::Draft && ! _targets.front().settings.parallelSegments)
+            phase = "Processing audio (draft)...";
+        else if (_targets.front().settings.parallelSegments)
+            phase = "Processing audio in parallel segments...";
+        else if (_targets.front().settings.memoryLimit > 0)
+            phase = "Processing audio in windows...";
         else
-            setStatusMessage ("Processing audio...");
+            phase = p < 0.5 ? "Analyzing audio (study phase)..." : "Processing audio...";
+        showStatus();
+    };
+
+    // Show which stage is holding the export up
+    progress.onStageLoad = [&stages, &showStatus] (const Exporter::StageLoad& load) {
+        auto percent = [] (double x) { return juce::String (juce::roundToInt (x * 100.0)) + "%"; };
+        stages = "decode " + percent (load.decode) + ", stretch " + percent (load.stretch) + ", write " + percent (load.write);
+        showStatus();
+    };
+
+    // Windowed exports say how much they're holding, which stays flat
+    progress.onMemoryUsage = [&memory, &showStatus] (juce::int64 bytes) {
+        memory = juce::File::descriptionOfSizeInBytes (bytes) + " in use";
+        showStatus();
+    };
+
+    // How far ahead of real time the encoder keeps, so a slow one shows up
+    progress.onEncodeSpeed = [&speed, &showStatus] (double timesRealtime) {
+        speed = "encoding " + juce::String (juce::roundToInt (timesRealtime)) + "x real time";
+        showStatus();
     };
 
     progress.shouldCancel = [this]() {
         return threadShouldExit();
     };
 
-    // Perform the export
-    _result = _exporter.exportAudio (_inputFile,
-                                     _outputFile,
-                                     _settings,
-                                     _sourceFreq,
-                                     _targetFreq,
-                                     progress);
+    // The exporter's decode and write threads step aside for playback too
+    progress.onThreadStart = [this]() { _threadPolicy.enterExport(); };
+    progress.onThreadEnd = [this]() { _threadPolicy.leaveExport(); };
+
+    // Perform the export, stepping aside for playback
+    _threadPolicy.enterExport();
+    _result = _exporter.exportTargets (_inputFile, _targets, _sourceFreq, progress);
+    _threadPolicy.leaveExport();
 }
 
 void ExportThread::threadComplete (bool userPressedCancel)
 {
     if (userPressedCancel) {
-        // Clean up partial output file if cancelled
-        if (_outputFile.existsAsFile())
-            _outputFile.deleteFile();
+        // Clean up partial output files if cancelled
+        for (const auto& target : _targets)
+            if (target.outputFile.existsAsFile())
+                target.outputFile.deleteFile();
 
         juce::AlertWindow::showMessageBoxAsync (
             juce::MessageBoxIconType::WarningIcon,
@@ -67,7 +113,7 @@ void ExportThread::threadComplete (bool userPressedCancel)
         juce::AlertWindow::showMessageBoxAsync (
             juce::MessageBoxIconType::InfoIcon,
             "Export Complete",
-            "Audio exported successfully to:\n" + _outputFile.getFullPathName());
+            "Audio exported successfully to:\n" + outputList());
     } else {
         juce::AlertWindow::showMessageBoxAsync (
             juce::MessageBoxIconType::WarningIcon,
@@ -79,5 +125,13 @@ void ExportThread::threadComplete (bool userPressedCancel)
     delete this;
 }
 
+juce::String ExportThread::outputList() const
+{
+    juce::StringArray paths;
+    for (const auto& target : _targets)
+        paths.add (target.outputFile.getFullPathName());
+    return paths.joinIntoString ("\n");
+}
+
 } // namespace app
 } // namespace retuner
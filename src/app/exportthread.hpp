@@ -4,7 +4,9 @@
 #pragma once
 
 #include <juce_gui_basics/juce_gui_basics.h>
+#include "exportcache.hpp"
 #include "exporter.hpp"
+#include "threadpolicy.hpp"
 
 namespace retuner {
 namespace app {
@@ -15,11 +17,11 @@ namespace app {
  */
 class ExportThread : public juce::ThreadWithProgressWindow {
 public:
+    /** Exports every target from the same input; see Exporter::exportTargets(). */
     ExportThread (const juce::File& inputFile,
-                  const juce::File& outputFile,
-                  const Exporter::ExportSettings& settings,
+                  std::vector<Exporter::Target> targets,
                   float sourceFreq,
-                  float targetFreq);
+                  ThreadPolicy& threadPolicy);
 
     ~ExportThread() override;
 
@@ -34,13 +36,15 @@ public:
 
 private:
     juce::File _inputFile;
-    juce::File _outputFile;
-    Exporter::ExportSettings _settings;
+    std::vector<Exporter::Target> _targets;
     float _sourceFreq;
-    float _targetFreq;
+    ThreadPolicy& _threadPolicy;
     juce::Result _result;
+    std::unique_ptr<ExportCache> _cache;
     Exporter _exporter;
 
+    juce::String outputList() const;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ExportThread)
 };
 
@@ -11,6 +11,15 @@
 namespace retuner {
 namespace app {
 
+namespace {
+/** Choices for closing the audio device when idle, in seconds */
+constexpr int idleTimeouts[] = { 0, 60, 300, 900, 3600 };
+constexpr const char* idleTimeoutNames[] = { "Never", "After 1 Minute", "After 5 Minutes", "After 15 Minutes", "After 1 Hour" };
+
+/** Memory an export may hold when the user asks for a limit */
+constexpr juce::int64 exportMemoryLimit = juce::int64 (512) << 20;
+} // namespace
+
 MainWindow::MainWindow (const juce::String& name)
     : juce::DocumentWindow (name,
                             juce::Colour (0xff2a2a2a), // Dark background
@@ -69,7 +78,7 @@ void MainWindow::setupMenuBar()
 
 juce::StringArray MainWindow::getMenuBarNames()
 {
-    return { "File", "Help" };
+    return { "File", "Playback", "Help" };
 }
 
 juce::PopupMenu MainWindow::getMenuForIndex (int topLevelMenuIndex, const juce::String& menuName)
@@ -78,6 +87,8 @@ juce::PopupMenu MainWindow::getMenuForIndex (int topLevelMenuIndex, const juce::
 
     if (menuName == "File") {
         menu.addItem (fileOpen, "Open...", true);
+        menu.addItem (fileAddToQueue, "Add to Queue...", true);
+        menu.addItem (fileClearQueue, "Clear Queue", ! Application::engineRef().queue().isEmpty());
         menu.addSeparator();
         menu.addItem (fileResetProcessorState, "Reset Defaults");
         menu.addItem (fileExport, "Export...", hasAudioFileLoaded());
@@ -85,6 +96,27 @@ juce::PopupMenu MainWindow::getMenuForIndex (int topLevelMenuIndex, const juce::
         menu.addItem (filePreferences, "Preferences...", true);
         menu.addSeparator();
         menu.addItem (fileQuit, "Quit", true);
+    } else if (menuName == "Playback") {
+        auto& engine = Application::engineRef();
+        menu.addItem (playbackHearOriginal, "Hear Original", true, ! engine.isReTunerEnabled());
+        menu.addSeparator();
+        menu.addItem (playbackLoopStart, "Set Loop Start", hasAudioFileLoaded());
+        menu.addItem (playbackLoopEnd, "Set Loop End", hasAudioFileLoaded() && engine.getPosition() > _loopStart);
+        menu.addItem (playbackClearLoop, "Clear Loop", ! engine.loopRegion().isEmpty());
+        menu.addSeparator();
+        menu.addItem (playbackLiveInput, "Live Input", true, engine.isLiveInputEnabled());
+        if (engine.isLiveInputEnabled())
+            menu.addItem (-1, "Estimated Round Trip Latency: " + juce::String (engine.estimatedLiveLatency() * 1000.0, 1) + " ms", false);
+        menu.addSeparator();
+        menu.addItem (playbackHighQualityPreview, "High-Quality Preview", true, engine.isHighQualityPreviewEnabled());
+        menu.addItem (playbackSinglePassResampling, "Single-Pass Resampling", true, engine.isSinglePassResamplingEnabled());
+        menu.addItem (playbackMatchDeviceSampleRate, "Match Device Sample Rate", true, engine.isMatchDeviceSampleRateEnabled());
+        menu.addSeparator();
+
+        juce::PopupMenu idle;
+        for (int i = 0; i < static_cast<int> (std::size (idleTimeouts)); ++i)
+            idle.addItem (playbackIdleTimeout + i, idleTimeoutNames[i], true, engine.idleTimeout() == idleTimeouts[i]);
+        menu.addSubMenu ("Close Device When Idle", idle);
     } else if (menuName == "Help") {
         menu.addItem (helpUserManual, "User Manual", true);
         menu.addSeparator();
@@ -103,6 +135,14 @@ void MainWindow::menuItemSelected (int menuItemID, int topLevelMenuIndex)
             showOpenFileDialog();
             break;
 
+        case fileAddToQueue:
+            showOpenFileDialog (true);
+            break;
+
+        case fileClearQueue:
+            Application::engineRef().clearQueue();
+            break;
+
         case fileExport:
             showExportDialog();
             break;
@@ -119,6 +159,53 @@ void MainWindow::menuItemSelected (int menuItemID, int topLevelMenuIndex)
             resetProcessorState();
             break;
 
+        case playbackHearOriginal: {
+            auto& engine = Application::engineRef();
+            engine.enableReTuner (! engine.isReTunerEnabled());
+            break;
+        }
+
+        case playbackLoopStart:
+            _loopStart = Application::engineRef().getPosition();
+            break;
+
+        case playbackLoopEnd: {
+            auto& engine = Application::engineRef();
+            if (! engine.setLoopRegion (_loopStart, engine.getPosition()))
+                juce::AlertWindow::showMessageBoxAsync (juce::MessageBoxIconType::WarningIcon,
+                                                        "Loop",
+                                                        "The loop must be between 0.1 seconds and 2 minutes long.");
+            break;
+        }
+
+        case playbackClearLoop:
+            Application::engineRef().clearLoopRegion();
+            break;
+
+        case playbackLiveInput: {
+            auto& engine = Application::engineRef();
+            engine.setLiveInput (! engine.isLiveInputEnabled());
+            break;
+        }
+
+        case playbackHighQualityPreview: {
+            auto& engine = Application::engineRef();
+            engine.setHighQualityPreview (! engine.isHighQualityPreviewEnabled());
+            break;
+        }
+
+        case playbackSinglePassResampling: {
+            auto& engine = Application::engineRef();
+            engine.setSinglePassResampling (! engine.isSinglePassResamplingEnabled());
+            break;
+        }
+
+        case playbackMatchDeviceSampleRate: {
+            auto& engine = Application::engineRef();
+            engine.setMatchDeviceSampleRate (! engine.isMatchDeviceSampleRateEnabled());
+            break;
+        }
+
         case helpUserManual:
             // TODO: Open user manual or help documentation
             juce::AlertWindow::showMessageBoxAsync (juce::AlertWindow::InfoIcon,
@@ -126,13 +213,21 @@ void MainWindow::menuItemSelected (int menuItemID, int topLevelMenuIndex)
                                                     "User manual coming soon!\n\nFor now, ReTuner is a frequency retuning tool that converts audio from one reference frequency to another.");
             break;
 
-        case helpAbout:
-            juce::AlertWindow::showMessageBoxAsync (juce::AlertWindow::InfoIcon,
-                                                    "About ReTuner",
-                                                    "ReTuner v1.0\n\nA professional audio frequency retuning tool.\n\nBuilt with JUCE framework.\n\n(c) 2025 Kushview");
+        case helpAbout: {
+            juce::String message ("ReTuner v1.0\n\nA professional audio frequency retuning tool.\n\nBuilt with JUCE framework.\n\n(c) 2025 Kushview");
+
+            // Let people find out why playback may glitch under load
+            const auto problems = Application::engineRef().threadPolicy().problems();
+            if (! problems.isEmpty())
+                message << "\n\nThread scheduling:\n" << problems.joinIntoString ("\n");
+
+            juce::AlertWindow::showMessageBoxAsync (juce::AlertWindow::InfoIcon, "About ReTuner", message);
             break;
+        }
 
         default:
+            if (juce::isPositiveAndBelow (menuItemID - playbackIdleTimeout, static_cast<int> (std::size (idleTimeouts))))
+                Application::engineRef().setIdleTimeout (idleTimeouts[menuItemID - playbackIdleTimeout]);
             break;
     }
 }
@@ -220,7 +315,11 @@ void MainWindow::showExportDialog()
         settings.quality = dialogPtr->quality();
         settings.format = dialogPtr->format();
         settings.bitDepth = dialogPtr->bitDepth();
+        settings.compressionLevel = dialogPtr->compressionLevel();
         settings.enableUpsampling = dialogPtr->shouldUpsample();
+        settings.parallelSegments = dialogPtr->shouldSplitIntoSegments();
+        if (dialogPtr->shouldLimitMemory())
+            settings.memoryLimit = exportMemoryLimit;
 
         if (settings.enableUpsampling)
             settings.upsampleRate = 96000.0;
@@ -228,9 +327,16 @@ void MainWindow::showExportDialog()
         // Get input file from engine
         auto inputFile = Application::engineRef().currentFile();
 
+        // The current target, plus any others the same decode can serve
+        std::vector<Exporter::Target> targets;
+        targets.push_back ({ outputFile, targetFreq, settings });
+        for (auto frequency : dialogPtr->extraTargetFrequencies())
+            if (! juce::approximatelyEqual (frequency, targetFreq))
+                targets.push_back ({ dialogPtr->outputFileFor (frequency), frequency, settings });
+
         // Create and launch export thread
         // Thread will delete itself when complete (see threadComplete())
-        auto* exportThread = new ExportThread (inputFile, outputFile, settings, sourceFreq, targetFreq);
+        auto* exportThread = new ExportThread (inputFile, std::move (targets), sourceFreq, Application::engineRef().threadPolicy());
         exportThread->launchThread();
 
         // Close the dialog
@@ -282,7 +388,7 @@ void MainWindow::resetProcessorState()
     settings.flush();
 }
 
-void MainWindow::showOpenFileDialog()
+void MainWindow::showOpenFileDialog (bool addToQueue)
 {
     auto& engine = Application::engineRef();
     auto& formats = engine.formatManager();
@@ -291,12 +397,22 @@ void MainWindow::showOpenFileDialog()
     static std::unique_ptr<juce::FileChooser> fileChooser;
 
     fileChooser = std::make_unique<juce::FileChooser> (
-        "Select an audio file to play...",
+        addToQueue ? "Select audio files to play next..." : "Select an audio file to play...",
         juce::File(),
         formats.getWildcardForAllFormats());
 
     auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
 
+    if (addToQueue) {
+        flags |= juce::FileBrowserComponent::canSelectMultipleItems;
+        fileChooser->launchAsync (flags, [] (const juce::FileChooser& chooser) {
+            for (const auto& file : chooser.getResults())
+                if (file.existsAsFile())
+                    Application::engineRef().enqueue (file);
+        });
+        return;
+    }
+
     fileChooser->launchAsync (flags, [this] (const juce::FileChooser& chooser) {
         auto file = chooser.getResult();
         if (file.existsAsFile()) {
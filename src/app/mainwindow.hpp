@@ -29,17 +29,32 @@ private:
     void setupMenuBar();
     void openAudioSettingsDialog();
     void showExportDialog();
-    void showOpenFileDialog();
+    void showOpenFileDialog (bool addToQueue = false);
     void resetProcessorState();
     bool hasAudioFileLoaded() const;
 
+    double _loopStart { 0.0 };
+
     enum MenuItemIDs {
         fileOpen = 1001,
+        fileAddToQueue = 1002,
         fileExport = 1003,
         fileResetProcessorState = 1004,
+        fileClearQueue = 1005,
         filePreferences = 1006,
         fileQuit = 1007,
 
+        playbackHighQualityPreview = 2001,
+        playbackSinglePassResampling,
+        playbackMatchDeviceSampleRate,
+        playbackHearOriginal,
+        playbackLoopStart,
+        playbackLoopEnd,
+        playbackClearLoop,
+        playbackLiveInput,
+
+        playbackIdleTimeout = 2100, // one per entry in idleTimeouts
+
         helpAbout = 4000,
         helpUserManual
     };
@@ -0,0 +1,336 @@
+// Copyright (c) 2025 Kushview, LLC
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "mp3seekindex.hpp"
+
+namespace retuner {
+namespace app {
+
+namespace detail {
+/** Frames decoded ahead of a seek position and thrown away */
+static constexpr int seekPrerollFrames = 8;
+/** Identifies index files, followed by the format version */
+static constexpr int indexMagic = 0x49535452; // "RTSI"
+static constexpr int indexVersion = 1;
+/** Samples compared when checking an index */
+static constexpr int probeSamples = 2048;
+/** Largest difference allowed between indexed and sequential decoding */
+static constexpr float probeTolerance = 1.0e-4f;
+
+/** Frame length in bytes if the four bytes start an MPEG-1 Layer III frame header, else 0. */
+inline static int mpeg1Layer3FrameLength (const juce::uint8* h, int& sampleRate, bool& mono) noexcept
+{
+    static constexpr int bitrates[] = { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 };
+    static constexpr int rates[] = { 44100, 48000, 32000, 0 };
+
+    if (h[0] != 0xff || (h[1] & 0xfe) != 0xfa) // sync, MPEG-1, Layer III
+        return 0;
+
+    const int bitrate = bitrates[h[2] >> 4];
+    const int rate = rates[(h[2] >> 2) & 3];
+    if (bitrate == 0 || rate == 0)
+        return 0;
+
+    sampleRate = rate;
+    mono = (h[3] >> 6) == 3;
+    return 144000 * bitrate / rate + ((h[2] >> 1) & 1);
+}
+
+inline static std::unique_ptr<juce::AudioFormatReader> createDecoder (const juce::File& file, juce::int64 offset)
+{
+    auto stream = std::make_unique<juce::FileInputStream> (file);
+    if (stream->failedToOpen())
+        return nullptr;
+
+    juce::MP3AudioFormat format;
+    return std::unique_ptr<juce::AudioFormatReader> (
+        format.createReaderFor (new juce::SubregionStream (stream.release(), offset, -1, true), true));
+}
+} // namespace detail
+
+//==============================================================================
+bool Mp3SeekIndex::matches (const juce::File& file) const
+{
+    return file.getSize() == fileSize && file.getLastModificationTime().toMilliseconds() == modified;
+}
+
+std::shared_ptr<Mp3SeekIndex> Mp3SeekIndex::build (const juce::File& file, const std::function<bool()>& shouldExit)
+{
+    juce::FileInputStream fileStream (file);
+    if (fileStream.failedToOpen())
+        return nullptr;
+
+    auto index = std::make_shared<Mp3SeekIndex>();
+    index->fileSize = file.getSize();
+    index->modified = file.getLastModificationTime().toMilliseconds();
+
+    juce::BufferedInputStream in (fileStream, 1 << 16);
+    juce::uint8 header[10] {};
+
+    // Skip an ID3v2 tag, whose size is stored 7 bits per byte
+    juce::int64 position = 0;
+    if (in.read (header, 10) == 10 && header[0] == 'I' && header[1] == 'D' && header[2] == '3')
+        position = 10 + ((header[6] & 0x7f) << 21 | (header[7] & 0x7f) << 14 | (header[8] & 0x7f) << 7 | (header[9] & 0x7f));
+
+    bool hasInfoFrame = false;
+    int fileRate = 0;
+    while (position + 4 <= index->fileSize) {
+        if ((index->offsets.size() & 4095) == 0 && shouldExit())
+            return nullptr;
+
+        in.setPosition (position);
+        if (in.read (header, 4) != 4)
+            break;
+
+        int rate = 0;
+        bool mono = false;
+        const int length = detail::mpeg1Layer3FrameLength (header, rate, mono);
+
+        // Resynchronise past junk, and stop at an ID3v1 tag
+        if (length == 0 || (fileRate != 0 && rate != fileRate)) {
+            if (header[0] == 'T' && header[1] == 'A' && header[2] == 'G')
+                break;
+            if (index->offsets.isEmpty() && position > 1 << 20)
+                return nullptr; // not MPEG-1 Layer III
+            ++position;
+            continue;
+        }
+
+        // Trust the first frame only if another follows straight after it.
+        // It may be a Xing/Info header, found after the side information.
+        if (index->offsets.isEmpty()) {
+            juce::uint8 next[4] {};
+            int nextRate = 0;
+            in.setPosition (position + length);
+            if (in.read (next, 4) != 4 || detail::mpeg1Layer3FrameLength (next, nextRate, mono) == 0 || nextRate != rate) {
+                ++position;
+                continue;
+            }
+
+            fileRate = rate;
+            mono = (header[3] >> 6) == 3;
+            juce::uint8 tag[4] {};
+            in.setPosition (position + 4 + (mono ? 17 : 32));
+            hasInfoFrame = in.read (tag, 4) == 4 && (std::memcmp (tag, "Xing", 4) == 0 || std::memcmp (tag, "Info", 4) == 0);
+        }
+
+        index->offsets.add (position);
+        position += length;
+    }
+
+    if (index->offsets.size() < 2)
+        return nullptr;
+
+    // Decode sequentially from the start and compare with decoding through the
+    // index, counting a leading Info frame either way. Probes in silence can't
+    // tell the two apart, so move on until one has signal.
+    for (const int probeFrame : { 40, 200, 1000 }) {
+        if (probeFrame + detail::seekPrerollFrames >= index->offsets.size() - 1 || shouldExit())
+            break;
+
+        auto reference = detail::createDecoder (file, 0);
+        if (reference == nullptr)
+            return nullptr;
+
+        const int channels = static_cast<int> (reference->numChannels);
+        juce::AudioBuffer<float> expected (channels, detail::probeSamples);
+        juce::AudioBuffer<float> actual (channels, detail::probeSamples);
+
+        const auto probe = static_cast<juce::int64> (probeFrame) * samplesPerFrame + samplesPerFrame / 3;
+        expected.clear();
+        juce::AudioBuffer<float> skip (channels, samplesPerFrame);
+        for (juce::int64 p = 0; p < probe; p += samplesPerFrame)
+            reference->read (&skip, 0, static_cast<int> (juce::jmin<juce::int64> (samplesPerFrame, probe - p)), p, true, true);
+        reference->read (&expected, 0, detail::probeSamples, probe, true, true);
+
+        if (expected.getMagnitude (0, detail::probeSamples) < 1.0e-3f)
+            continue;
+
+        for (int first = 0; first <= (hasInfoFrame ? 1 : 0); ++first) {
+            index->firstAudioFrame = first;
+            IndexedMp3Reader indexed (file, index);
+            actual.clear();
+            if (! indexed.isValid() || ! indexed.read (&actual, 0, detail::probeSamples, probe, true, true))
+                continue;
+
+            float difference = 0.0f;
+            for (int ch = 0; ch < channels; ++ch) {
+                const auto* a = actual.getReadPointer (ch);
+                const auto* e = expected.getReadPointer (ch);
+                for (int i = 0; i < detail::probeSamples; ++i)
+                    difference = juce::jmax (difference, std::abs (a[i] - e[i]));
+            }
+
+            if (difference <= detail::probeTolerance)
+                return index;
+        }
+
+        return nullptr;
+    }
+
+    return nullptr;
+}
+
+bool Mp3SeekIndex::save (const juce::File& destination) const
+{
+    // Frame offsets as deltas, which are frame lengths and pack into two bytes
+    juce::MemoryOutputStream out;
+    out.writeInt (detail::indexMagic);
+    out.writeInt (detail::indexVersion);
+    out.writeInt64 (fileSize);
+    out.writeInt64 (modified);
+    out.writeInt (firstAudioFrame);
+    out.writeInt (offsets.size());
+    juce::int64 previous = 0;
+    for (const auto offset : offsets) {
+        out.writeCompressedInt (static_cast<int> (offset - previous));
+        previous = offset;
+    }
+
+    // Write beside the destination and move it into place so readers never see half a file
+    destination.getParentDirectory().createDirectory();
+    juce::TemporaryFile temp (destination);
+    return temp.getFile().replaceWithData (out.getData(), out.getDataSize()) && temp.overwriteTargetFileWithTemporary();
+}
+
+std::shared_ptr<Mp3SeekIndex> Mp3SeekIndex::load (const juce::File& source)
+{
+    juce::FileInputStream in (source);
+    if (in.failedToOpen() || in.readInt() != detail::indexMagic || in.readInt() != detail::indexVersion)
+        return nullptr;
+
+    auto index = std::make_shared<Mp3SeekIndex>();
+    index->fileSize = in.readInt64();
+    index->modified = in.readInt64();
+    index->firstAudioFrame = in.readInt();
+    const int numFrames = in.readInt();
+    if (numFrames < 2 || ! juce::isPositiveAndNotGreaterThan (index->firstAudioFrame, 1))
+        return nullptr;
+
+    index->offsets.ensureStorageAllocated (numFrames);
+    juce::int64 offset = 0;
+    for (int i = 0; i < numFrames; ++i) {
+        if (in.isExhausted())
+            return nullptr;
+        offset += in.readCompressedInt();
+        index->offsets.add (offset);
+    }
+
+    return index;
+}
+
+//==============================================================================
+IndexedMp3Reader::IndexedMp3Reader (const juce::File& file, std::shared_ptr<const Mp3SeekIndex> index)
+    : juce::AudioFormatReader (nullptr, "MP3 file"),
+      _file (file),
+      _index (std::move (index))
+{
+    if (! startDecoder (0))
+        return;
+
+    sampleRate = _decoder->sampleRate;
+    bitsPerSample = _decoder->bitsPerSample;
+    numChannels = _decoder->numChannels;
+    usesFloatingPointData = _decoder->usesFloatingPointData;
+    metadataValues = _decoder->metadataValues;
+    lengthInSamples = _index->lengthInSamples();
+}
+
+bool IndexedMp3Reader::startDecoder (juce::int64 position)
+{
+    const auto frame = static_cast<int> (position / Mp3SeekIndex::samplesPerFrame);
+    const auto first = juce::jmax (0, frame - detail::seekPrerollFrames);
+    const auto offsetIndex = juce::jmin (first + _index->firstAudioFrame, _index->offsets.size() - 1);
+
+    _decoder = detail::createDecoder (_file, _index->offsets[offsetIndex]);
+    if (_decoder == nullptr)
+        return false;
+
+    // The decoder's own length is an estimate; the index knows exactly
+    _decoderOrigin = static_cast<juce::int64> (first) * Mp3SeekIndex::samplesPerFrame;
+    _decoder->lengthInSamples = _index->lengthInSamples() - _decoderOrigin;
+    _nextSample = -1;
+    return true;
+}
+
+bool IndexedMp3Reader::readSamples (int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer, juce::int64 startSampleInFile, int numSamples)
+{
+    // Carry on sequentially, or start over a few frames before the position.
+    // The decoder discards those frames itself on its short way there.
+    if (startSampleInFile != _nextSample || _decoder == nullptr) {
+        if (! startDecoder (startSampleInFile)) {
+            for (int ch = 0; ch < numDestChannels; ++ch)
+                if (destChannels[ch] != nullptr)
+                    juce::zeromem (destChannels[ch] + startOffsetInDestBuffer, sizeof (int) * (size_t) numSamples);
+            return false;
+        }
+    }
+
+    _nextSample = startSampleInFile + numSamples;
+    return _decoder->readSamples (destChannels, numDestChannels, startOffsetInDestBuffer, startSampleInFile - _decoderOrigin, numSamples);
+}
+
+//==============================================================================
+class Mp3SeekIndexCache::BuildJob : public juce::ThreadPoolJob {
+public:
+    BuildJob (Mp3SeekIndexCache& owner, const juce::File& file)
+        : juce::ThreadPoolJob ("MP3 seek index"),
+          _owner (owner),
+          _file (file) {}
+
+    JobStatus runJob() override
+    {
+        auto index = Mp3SeekIndex::build (_file, [this]() { return shouldExit(); });
+        const bool saved = index != nullptr && index->save (_owner.indexFile (_file));
+
+        const juce::ScopedLock sl (_owner._lock);
+        _owner._building.removeString (_file.getFullPathName());
+        if (! saved && ! shouldExit())
+            _owner._failed.add (_file.getFullPathName());
+        return jobHasFinished;
+    }
+
+private:
+    Mp3SeekIndexCache& _owner;
+    juce::File _file;
+};
+
+//==============================================================================
+Mp3SeekIndexCache::Mp3SeekIndexCache (const juce::File& directory)
+    : _directory (directory),
+      _pool (1, 0, juce::Thread::Priority::background)
+{
+}
+
+Mp3SeekIndexCache::~Mp3SeekIndexCache()
+{
+    _pool.removeAllJobs (true, 5000);
+}
+
+juce::File Mp3SeekIndexCache::indexFile (const juce::File& file) const
+{
+    return _directory.getChildFile (juce::String::toHexString (file.getFullPathName().hashCode64()) + ".mp3index");
+}
+
+std::unique_ptr<juce::AudioFormatReader> Mp3SeekIndexCache::createReaderFor (const juce::File& file)
+{
+    if (! file.hasFileExtension ("mp3"))
+        return nullptr;
+
+    if (auto index = Mp3SeekIndex::load (indexFile (file)); index != nullptr && index->matches (file)) {
+        auto reader = std::make_unique<IndexedMp3Reader> (file, std::move (index));
+        if (reader->isValid())
+            return reader;
+    }
+
+    const juce::ScopedLock sl (_lock);
+    const auto path = file.getFullPathName();
+    if (! _building.contains (path) && ! _failed.contains (path)) {
+        _building.add (path);
+        _pool.addJob (new BuildJob (*this, file), true);
+    }
+    return nullptr;
+}
+
+} // namespace app
+} // namespace retuner
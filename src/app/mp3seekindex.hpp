@@ -0,0 +1,108 @@
+// Copyright (c) 2025 Kushview, LLC
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_core/juce_core.h>
+
+namespace retuner {
+namespace app {
+
+/**
+ * Byte offsets of every frame in an MPEG-1 Layer III file.
+ *
+ * JUCE's MP3 reader finds a position by scanning frames from the start of
+ * the file, which gets slow deep into long files. With the offsets known, a
+ * decoder can start a few frames before any position instead.
+ *
+ * An index is only trusted once decoding through it has been checked against
+ * decoding the file from the start. The check also settles whether a leading
+ * Xing/Info frame counts towards sample positions.
+ */
+struct Mp3SeekIndex {
+    static constexpr int samplesPerFrame = 1152;
+
+    juce::int64 fileSize { 0 };
+    juce::int64 modified { 0 };    // file modification time, ms
+    int firstAudioFrame { 0 };     // 1 when a leading Xing/Info frame doesn't count
+    juce::Array<juce::int64> offsets;
+
+    int numAudioFrames() const noexcept { return offsets.size() - firstAudioFrame; }
+    juce::int64 lengthInSamples() const noexcept { return static_cast<juce::int64> (numAudioFrames()) * samplesPerFrame; }
+
+    /** True if the index was made for the file as it is now. */
+    bool matches (const juce::File& file) const;
+
+    /**
+     * Scan a file's frames and check decoding through them.
+     * @return nullptr if the file isn't MPEG-1 Layer III, the check fails, or the scan was cancelled
+     */
+    static std::shared_ptr<Mp3SeekIndex> build (const juce::File& file, const std::function<bool()>& shouldExit);
+
+    bool save (const juce::File& destination) const;
+    static std::shared_ptr<Mp3SeekIndex> load (const juce::File& source);
+};
+
+//==============================================================================
+/**
+ * MP3 reader that seeks through an Mp3SeekIndex.
+ *
+ * Reading carries on sequentially from wherever the last read ended. A read
+ * anywhere else starts a fresh decoder a few frames earlier, so the bit
+ * reservoir and the synthesis filter are filled by the time the position is
+ * reached. Seeks cost the same at any point in the file.
+ */
+class IndexedMp3Reader : public juce::AudioFormatReader {
+public:
+    IndexedMp3Reader (const juce::File& file, std::shared_ptr<const Mp3SeekIndex> index);
+
+    /** False if the file couldn't be opened. */
+    bool isValid() const noexcept { return _decoder != nullptr; }
+
+    bool readSamples (int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer, juce::int64 startSampleInFile, int numSamples) override;
+
+private:
+    juce::File _file;
+    std::shared_ptr<const Mp3SeekIndex> _index;
+    std::unique_ptr<juce::AudioFormatReader> _decoder;
+    juce::int64 _decoderOrigin { 0 };   // sample position of the decoder's first frame
+    juce::int64 _nextSample { -1 };     // where sequential reading continues
+
+    bool startDecoder (juce::int64 position);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (IndexedMp3Reader)
+};
+
+//==============================================================================
+/**
+ * Seek indexes for MP3 files, kept in a cache directory keyed by file path
+ * and checked against the file's size and modification time.
+ *
+ * A file without an index yet is opened the usual way while its index is
+ * built in the background, ready for the next time it loads.
+ */
+class Mp3SeekIndexCache {
+public:
+    explicit Mp3SeekIndexCache (const juce::File& directory);
+    ~Mp3SeekIndexCache();
+
+    /** A reader seeking through the file's index, or nullptr if there isn't one (yet). */
+    std::unique_ptr<juce::AudioFormatReader> createReaderFor (const juce::File& file);
+
+private:
+    class BuildJob;
+
+    juce::File _directory;
+    juce::ThreadPool _pool;
+    juce::CriticalSection _lock;
+    juce::StringArray _building;  // paths with a build queued or running
+    juce::StringArray _failed;    // paths that can't be indexed, not retried this session
+
+    juce::File indexFile (const juce::File& file) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Mp3SeekIndexCache)
+};
+
+} // namespace app
+} // namespace retuner
@@ -0,0 +1,285 @@
+// Copyright (c) 2025 Kushview, LLC
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "playlistsource.hpp"
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#if JUCE_LINUX
+ #include <fcntl.h>
+ #include <unistd.h>
+#endif
+
+namespace retuner {
+namespace app {
+
+namespace detail {
+/** How much of a file the OS is asked to read ahead of the read-ahead thread */
+static constexpr double hintSeconds = 8.0;
+/** Per-read decay of the slowest read time */
+static constexpr double slowestReadDecay = 0.999;
+} // namespace detail
+
+PlaylistSource::Item::~Item()
+{
+#if JUCE_LINUX
+    if (fd >= 0)
+        ::close (fd);
+#endif
+}
+
+std::unique_ptr<PlaylistSource::Item> PlaylistSource::createItem (std::unique_ptr<juce::AudioFormatReader> reader, const juce::File& file)
+{
+    auto item = std::make_unique<Item>();
+    item->file = file;
+    item->length = reader != nullptr ? reader->lengthInSamples : 0;
+    item->fileSize = file.getSize();
+    if (reader != nullptr) {
+        const auto format = reader->getFormatName();
+        item->compressed = ! (format.startsWithIgnoreCase ("WAV") || format.startsWithIgnoreCase ("AIFF"));
+    }
+    item->reader = std::move (reader);
+
+#if JUCE_LINUX
+    // A descriptor of our own, only for hints. The page cache is shared, so
+    // pages it brings in serve the reader's stream as well.
+    item->fd = ::open (file.getFullPathName().toRawUTF8(), O_RDONLY | O_CLOEXEC);
+    if (item->fd >= 0)
+        ::posix_fadvise (item->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    hint (*item, 0);
+    return item;
+}
+
+void PlaylistSource::hint (Item& item, juce::int64 offset)
+{
+#if JUCE_LINUX
+    if (item.fd < 0 || item.length <= 0 || item.reader == nullptr)
+        return;
+
+    // Start over after a seek, then wait until half the hinted window has been read before hinting again
+    const auto window = static_cast<juce::int64> (item.reader->sampleRate * detail::hintSeconds);
+    if (offset > item.hinted || offset + window < item.hinted)
+        item.hinted = offset;
+    if (offset + window / 2 < item.hinted || item.hinted >= item.length)
+        return;
+
+    // Map samples to bytes by proportion, which is close enough for compressed files too
+    const auto from = juce::jmax (offset, item.hinted);
+    const auto to = juce::jmin (item.length, offset + window);
+    const auto byteStart = item.fileSize * from / item.length;
+    const auto byteEnd = item.fileSize * to / item.length;
+    if (byteEnd > byteStart)
+        ::posix_fadvise (item.fd, static_cast<off_t> (byteStart), static_cast<off_t> (byteEnd - byteStart), POSIX_FADV_WILLNEED);
+    item.hinted = to;
+#else
+    juce::ignoreUnused (item, offset);
+#endif
+}
+
+void PlaylistSource::reset (std::unique_ptr<juce::AudioFormatReader> reader, const juce::File& file)
+{
+    const auto rate = reader != nullptr ? reader->sampleRate : 0.0;
+    auto item = createItem (std::move (reader), file);
+
+    const juce::ScopedLock sl (_lock);
+    _items.clear();
+    _items.push_back (std::move (item));
+    _position = 0;
+    _sampleRate = rate;
+    updateStarts();
+}
+
+bool PlaylistSource::append (std::unique_ptr<juce::AudioFormatReader> reader, const juce::File& file, int preloadSamples)
+{
+    if (reader == nullptr || ! juce::approximatelyEqual (reader->sampleRate, _sampleRate.load()))
+        return false;
+
+    auto item = createItem (std::move (reader), file);
+
+    // Decode the opening now, away from the read-ahead thread
+    const auto numHead = static_cast<int> (juce::jlimit<juce::int64> (0, item->length, preloadSamples));
+    item->head.setSize (2, numHead);
+    if (numHead > 0)
+        item->reader->read (&item->head, 0, numHead, 0, true, true);
+
+    const juce::ScopedLock sl (_lock);
+    item->start = _totalLength.load();
+    _items.push_back (std::move (item));
+    updateStarts();
+    return true;
+}
+
+int PlaylistSource::truncate (int lastItem)
+{
+    const juce::ScopedLock sl (_lock);
+    const auto position = _position.load();
+    while (static_cast<int> (_items.size()) > lastItem + 1 && _items.back()->start > position)
+        _items.pop_back();
+    updateStarts();
+    return static_cast<int> (_items.size());
+}
+
+void PlaylistSource::release (int firstItem)
+{
+    // Items are swapped for empty ones rather than emptied in place, so a read
+    // still in one keeps it open. The last reference closes it.
+    std::vector<std::shared_ptr<Item>> released;
+    const juce::ScopedLock sl (_lock);
+    for (int i = 0; i < juce::jmin (firstItem, static_cast<int> (_items.size())); ++i) {
+        auto& item = _items[(size_t) i];
+        if (item->reader == nullptr)
+            continue;
+
+        auto empty = std::make_shared<Item>();
+        empty->file = item->file;
+        empty->start = item->start;
+        empty->length = item->length;
+        empty->compressed = item->compressed;
+        released.push_back (std::exchange (item, std::move (empty)));
+    }
+}
+
+int PlaylistSource::numItems() const
+{
+    const juce::ScopedLock sl (_lock);
+    return static_cast<int> (_items.size());
+}
+
+juce::File PlaylistSource::file (int item) const
+{
+    const juce::ScopedLock sl (_lock);
+    return juce::isPositiveAndBelow (item, static_cast<int> (_items.size())) ? _items[(size_t) item]->file : juce::File();
+}
+
+juce::int64 PlaylistSource::itemStart (int item) const
+{
+    const juce::ScopedLock sl (_lock);
+    return juce::isPositiveAndBelow (item, static_cast<int> (_items.size())) ? _items[(size_t) item]->start : 0;
+}
+
+juce::int64 PlaylistSource::itemLength (int item) const
+{
+    const juce::ScopedLock sl (_lock);
+    return juce::isPositiveAndBelow (item, static_cast<int> (_items.size())) ? _items[(size_t) item]->length : 0;
+}
+
+int PlaylistSource::numChannels() const
+{
+    const juce::ScopedLock sl (_lock);
+    for (auto it = _items.rbegin(); it != _items.rend(); ++it)
+        if ((*it)->reader != nullptr)
+            return static_cast<int> ((*it)->reader->numChannels);
+    return 0;
+}
+
+bool PlaylistSource::isCompressed() const
+{
+    const juce::ScopedLock sl (_lock);
+    return std::any_of (_items.begin(), _items.end(), [] (const auto& item) { return item->compressed; });
+}
+
+PlaylistSource::Location PlaylistSource::locate (juce::int64 position) const noexcept
+{
+    Location location;
+    const juce::SpinLock::ScopedTryLockType sl (_startsLock);
+    if (! sl.isLocked() || _starts.size() < 2)
+        return location;
+
+    // Last item starting at or before the position
+    const auto* begin = _starts.begin();
+    const auto* end = _starts.end() - 1;
+    const auto* it = std::upper_bound (begin, end, position);
+    location.item = juce::jmax (0, static_cast<int> (it - begin) - 1);
+    location.offset = position - begin[location.item];
+    location.length = begin[location.item + 1] - begin[location.item];
+    location.last = location.item == _starts.size() - 2;
+    return location;
+}
+
+void PlaylistSource::updateStarts()
+{
+    juce::int64 total = 0;
+    {
+        const juce::SpinLock::ScopedLockType sl (_startsLock);
+        _starts.clearQuick();
+        for (const auto& item : _items) {
+            _starts.add (item->start);
+            total = item->start + item->length;
+        }
+        _starts.add (total);
+    }
+    _totalLength = total;
+}
+
+//==============================================================================
+void PlaylistSource::prepareToPlay (int, double) {}
+void PlaylistSource::releaseResources() {}
+
+void PlaylistSource::setNextReadPosition (juce::int64 newPosition)
+{
+    _position = newPosition;
+    _readPastEnd = false;
+}
+
+void PlaylistSource::getNextAudioBlock (const juce::AudioSourceChannelInfo& info)
+{
+    auto& dest = *info.buffer;
+    const auto started = juce::Time::getHighResolutionTicks();
+
+    auto position = _position.load();
+    int done = 0;
+    while (done < info.numSamples) {
+        // Find the item holding the position, reading silence over gaps and past
+        // the end. The read itself happens outside the lock.
+        std::shared_ptr<Item> current;
+        juce::int64 next = std::numeric_limits<juce::int64>::max();
+        {
+            const juce::ScopedLock sl (_lock);
+            for (const auto& item : _items) {
+                if (position >= item->start && position < item->start + item->length)
+                    current = item;
+                else if (item->start > position)
+                    next = juce::jmin (next, item->start);
+            }
+            if (current == nullptr && next == std::numeric_limits<juce::int64>::max())
+                _readPastEnd = true;
+        }
+
+        const auto available = current != nullptr ? current->start + current->length - position : next - position;
+        const int count = static_cast<int> (juce::jmin<juce::int64> (info.numSamples - done, available));
+
+        if (current != nullptr && current->reader != nullptr)
+            readItem (*current, dest, info.startSample + done, position - current->start, count);
+        else
+            dest.clear (info.startSample + done, count);
+
+        done += count;
+        position += count;
+    }
+
+    _position = position;
+
+    const auto seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - started);
+    _slowestRead = juce::jmax (seconds, _slowestRead.load() * detail::slowestReadDecay);
+}
+
+void PlaylistSource::readItem (Item& item, juce::AudioBuffer<float>& dest, int destStart, juce::int64 offset, int numSamples)
+{
+    // Opening samples come from memory
+    const int fromHead = static_cast<int> (juce::jlimit<juce::int64> (0, numSamples, item.head.getNumSamples() - offset));
+    if (fromHead > 0) {
+        for (int ch = 0; ch < dest.getNumChannels(); ++ch)
+            dest.copyFrom (ch, destStart, item.head, juce::jmin (ch, item.head.getNumChannels() - 1), static_cast<int> (offset), fromHead);
+    }
+
+    if (fromHead < numSamples)
+        item.reader->read (&dest, destStart + fromHead, numSamples - fromHead, offset + fromHead, true, true);
+
+    hint (item, offset + numSamples);
+}
+
+} // namespace app
+} // namespace retuner
@@ -0,0 +1,135 @@
+// Copyright (c) 2025 Kushview, LLC
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_core/juce_core.h>
+
+namespace retuner {
+namespace app {
+
+/**
+ * Audio files played back to back as one continuous stream.
+ *
+ * Items are appended while earlier ones play, so the read-ahead buffer in
+ * front of this source runs from the end of one item into the start of the
+ * next without a gap. The opening of each appended item is decoded up front,
+ * so the read-ahead never waits on the disk or a slow decoder at the join.
+ * Every item has the sample rate of the first.
+ *
+ * Reads happen on the read-ahead thread. Only finding the item to read takes
+ * the lock, so queries from the message thread never wait on the disk; items
+ * are shared so that one being read outlives truncate() and release(). Item
+ * boundaries are also kept behind a spin lock so the audio thread can locate
+ * positions without blocking. Each read is timed so the owner can size the read-ahead
+ * buffer for the disk it's actually reading from, and on Linux the kernel is
+ * asked to fetch the next few seconds of each file before they're needed.
+ */
+class PlaylistSource : public juce::PositionableAudioSource {
+public:
+    /** Where a stream position falls. */
+    struct Location {
+        int item { -1 };             ///< Item index, -1 if unknown
+        juce::int64 offset { 0 };    ///< Samples from the start of the item
+        juce::int64 length { 0 };    ///< Length of the item
+        bool last { true };          ///< True if no item follows
+    };
+
+    PlaylistSource() = default;
+    ~PlaylistSource() override = default;
+
+    /** Replace all items with a single one. */
+    void reset (std::unique_ptr<juce::AudioFormatReader> reader, const juce::File& file);
+
+    /**
+     * Append an item to play straight after the last one, decoding its opening
+     * samples first.
+     * @return false if its sample rate differs from the first item's
+     */
+    bool append (std::unique_ptr<juce::AudioFormatReader> reader, const juce::File& file, int preloadSamples);
+
+    /**
+     * Remove the items after the given one that reading hasn't reached yet.
+     * @return The number of items left
+     */
+    int truncate (int lastItem);
+
+    /**
+     * Close the readers of items before the given one. Their place in the
+     * stream is kept, and reads already under way finish first.
+     */
+    void release (int firstItem);
+
+    int numItems() const;
+    juce::File file (int item) const;
+    juce::int64 itemStart (int item) const;
+    juce::int64 itemLength (int item) const;
+    double sampleRate() const noexcept { return _sampleRate.load(); }
+    int numChannels() const;
+
+    /** Find the item at a stream position. Realtime safe; returns an unknown item if contended. */
+    Location locate (juce::int64 position) const noexcept;
+
+    /** True if any item is in a format that decodes in large frames, like MP3 or FLAC. */
+    bool isCompressed() const;
+
+    /**
+     * True if a read has run past the end of the last item since the last
+     * seek. A read-ahead buffer in front of this source then holds silence
+     * where items appended since belong, and has to be refilled.
+     */
+    bool hasReadPastEnd() const noexcept { return _readPastEnd.load(); }
+
+    /** Longest recent read in seconds. Decays slowly, so one stall is remembered for a while. */
+    double slowestRead() const noexcept { return _slowestRead.load(); }
+
+    //==============================================================================
+    void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock (const juce::AudioSourceChannelInfo& info) override;
+    void setNextReadPosition (juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override { return _position.load(); }
+    juce::int64 getTotalLength() const override { return _totalLength.load(); }
+    bool isLooping() const override { return false; }
+
+private:
+    struct Item {
+        juce::File file;
+        std::unique_ptr<juce::AudioFormatReader> reader;
+        juce::int64 start { 0 };
+        juce::int64 length { 0 };
+        juce::AudioBuffer<float> head; // decoded opening samples
+        bool compressed { false };
+
+        // Read-ahead hints to the OS
+        int fd { -1 };
+        juce::int64 fileSize { 0 };
+        juce::int64 hinted { 0 }; // samples from the start already hinted
+
+        ~Item();
+    };
+
+    mutable juce::CriticalSection _lock;
+    std::vector<std::shared_ptr<Item>> _items;
+    std::atomic<juce::int64> _position { 0 };
+    std::atomic<juce::int64> _totalLength { 0 };
+    std::atomic<double> _sampleRate { 0.0 };
+    std::atomic<double> _slowestRead { 0.0 };
+    std::atomic<bool> _readPastEnd { false };
+
+    // Item starts followed by the total length
+    mutable juce::SpinLock _startsLock;
+    juce::Array<juce::int64> _starts;
+
+    void updateStarts();
+    static std::unique_ptr<Item> createItem (std::unique_ptr<juce::AudioFormatReader> reader, const juce::File& file);
+    static void hint (Item& item, juce::int64 offset);
+    void readItem (Item& item, juce::AudioBuffer<float>& dest, int destStart, juce::int64 offset, int numSamples);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlaylistSource)
+};
+
+} // namespace app
+} // namespace retuner
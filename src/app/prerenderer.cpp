@@ -0,0 +1,214 @@
+// Copyright (c) 2025 Kushview, LLC
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "prerenderer.hpp"
+#include "wave64format.hpp"
+
+namespace retuner {
+namespace app {
+
+namespace detail {
+/** Segments within this distance of the playhead render eagerly */
+static constexpr double eagerSeconds = 60.0;
+/** How long idle workers wait before checking for work again */
+static constexpr int idleWaitMs = 100;
+
+inline static int numRenderThreads()
+{
+    // Leave room for the audio thread and the UI
+    return juce::jlimit (1, 4, juce::SystemStats::getNumCpus() / 2);
+}
+} // namespace detail
+
+//==============================================================================
+class PreRenderer::RenderJob : public juce::ThreadPoolJob {
+public:
+    RenderJob (PreRenderer& owner, std::unique_ptr<juce::AudioFormatReader> reader, bool lazy)
+        : juce::ThreadPoolJob ("Pre-render"),
+          _owner (owner),
+          _reader (std::move (reader)),
+          _lazy (lazy) {}
+
+    JobStatus runJob() override
+    {
+        if (! _policyApplied) {
+            _owner._threadPolicy.applyBackground();
+            _policyApplied = true;
+        }
+
+        if (! _owner.renderNext (*_reader, _lazy, [this]() { return shouldExit(); }))
+            _owner._wake.wait (detail::idleWaitMs);
+
+        return shouldExit() ? jobHasFinished : jobNeedsRunningAgain;
+    }
+
+private:
+    PreRenderer& _owner;
+    std::unique_ptr<juce::AudioFormatReader> _reader;
+    const bool _lazy;
+    bool _policyApplied { false };
+};
+
+//==============================================================================
+PreRenderer::PreRenderer (ThreadPolicy& threadPolicy)
+    : _threadPolicy (threadPolicy),
+      _pool (detail::numRenderThreads(), 0, juce::Thread::Priority::low),
+      _settings (Exporter::preset (Exporter::Quality::Maximum))
+{
+    _formatManager.registerBasicFormats();
+    _formatManager.registerFormat (new Wave64AudioFormat(), false);
+}
+
+PreRenderer::~PreRenderer()
+{
+    stop();
+}
+
+void PreRenderer::start (const juce::File& file, float pitchRatio)
+{
+    stop();
+
+    std::unique_ptr<juce::AudioFormatReader> reader (_formatManager.createReaderFor (file));
+    if (reader == nullptr || reader->lengthInSamples <= 0)
+        return;
+
+    {
+        const juce::ScopedLock sl (_cache.lock());
+        _file = file;
+        _lengthInSamples = reader->lengthInSamples;
+        _sampleRate.store (reader->sampleRate);
+    }
+
+    retune (pitchRatio);
+
+    // Every job needs its own reader since readers aren't thread safe.
+    // Only the first fills in segments far from the playhead.
+    _pool.addJob (new RenderJob (*this, std::move (reader), true), true);
+    for (int i = 1; i < _pool.getNumThreads(); ++i)
+        if (auto* r = _formatManager.createReaderFor (file))
+            _pool.addJob (new RenderJob (*this, std::unique_ptr<juce::AudioFormatReader> (r), false), true);
+}
+
+void PreRenderer::retune (float pitchRatio)
+{
+    {
+        const juce::ScopedLock sl (_cache.lock());
+        if (_file == juce::File())
+            return;
+
+        _take = _cache.acquire (RenderCache::Key (_file, pitchRatio, _settings.quality), _lengthInSamples, _sampleRate.load());
+        _pitchRatio.store (pitchRatio);
+    }
+
+    // Renders in flight for the previous take are abandoned
+    ++_generation;
+    _wake.signal();
+}
+
+void PreRenderer::stop()
+{
+    ++_generation;
+    _wake.signal();
+    _pool.removeAllJobs (true, 10000);
+
+    const juce::ScopedLock sl (_cache.lock());
+    _take.reset();
+    _file = juce::File();
+    _lengthInSamples = 0;
+}
+
+void PreRenderer::setFocus (juce::Range<juce::int64> range) noexcept
+{
+    _focusStart.store (range.getStart());
+    _focusEnd.store (range.getEnd());
+    _wake.signal();
+}
+
+juce::File PreRenderer::file() const
+{
+    const juce::ScopedLock sl (_cache.lock());
+    return _file;
+}
+
+double PreRenderer::progress() const
+{
+    const auto take = currentTake();
+    if (take == nullptr || take->numSegments() <= 0)
+        return 0.0;
+    return static_cast<double> (take->numReady()) / static_cast<double> (take->numSegments());
+}
+
+std::shared_ptr<RenderCache::Take> PreRenderer::currentTake() const
+{
+    const juce::ScopedLock sl (_cache.lock());
+    return _take;
+}
+
+//==============================================================================
+bool PreRenderer::isRendered (juce::int64 startSample, int numSamples) const noexcept
+{
+    const juce::ScopedTryLock sl (_cache.lock());
+    return sl.isLocked() && _take != nullptr && _take->isRendered (startSample, numSamples);
+}
+
+bool PreRenderer::read (juce::AudioBuffer<float>& dest, int destStartSample, juce::int64 startSample, int numSamples) const noexcept
+{
+    const juce::ScopedTryLock sl (_cache.lock());
+    if (! sl.isLocked() || _take == nullptr || ! _take->isRendered (startSample, numSamples))
+        return false;
+
+    _take->read (dest, destStartSample, startSample, numSamples);
+    return true;
+}
+
+//==============================================================================
+bool PreRenderer::renderNext (juce::AudioFormatReader& reader, bool lazy, const std::function<bool()>& shouldExit)
+{
+    const auto generation = _generation.load();
+    const auto take = currentTake();
+    if (take == nullptr || take->key().file != file())
+        return false;
+
+    const auto playhead = _playhead.load();
+    const auto eagerDistance = static_cast<juce::int64> (take->sampleRate() * detail::eagerSeconds);
+    const juce::Range<juce::int64> focus (_focusStart.load(), _focusEnd.load());
+    const bool focused = focus.getStart() > 0 || focus.getEnd() < std::numeric_limits<juce::int64>::max();
+
+    int index = take->claim (playhead, eagerDistance, focus);
+    if (index < 0 && lazy && ! focused) {
+        // Fill in the rest of the file only while there's room for it
+        const auto segmentBytes = static_cast<size_t> (reader.numChannels) * static_cast<size_t> (take->renderLength (0)) * sizeof (float);
+        if (_cache.hasRoomFor (segmentBytes))
+            index = take->claim (playhead, std::numeric_limits<juce::int64>::max());
+    }
+
+    if (index < 0)
+        return false;
+
+    auto cancelled = [&]() { return shouldExit() || _generation.load() != generation; };
+
+    juce::AudioBuffer<float> audio;
+    const auto result = Exporter::renderRange (reader,
+                                               take->segmentStart (index),
+                                               take->renderLength (index),
+                                               take->padding(),
+                                               _settings,
+                                               take->key().pitchRatio(),
+                                               audio,
+                                               cancelled);
+
+    if (result.failed()) {
+        if (cancelled())
+            take->release (index);
+        else
+            take->fail (index);
+        return true;
+    }
+
+    take->finish (index, std::move (audio));
+    _cache.trim (take.get(), _playhead.load());
+    return true;
+}
+
+} // namespace app
+} // namespace retuner
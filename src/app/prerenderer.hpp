@@ -0,0 +1,105 @@
+// Copyright (c) 2025 Kushview, LLC
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_core/juce_core.h>
+#include "exporter.hpp"
+#include "rendercache.hpp"
+#include "threadpolicy.hpp"
+
+namespace retuner {
+namespace app {
+
+/**
+ * Renders the loaded file through the offline export pipeline on background
+ * threads so preview playback can use it instead of the realtime stretcher.
+ *
+ * Rendered audio lives in a RenderCache. Segments near the playhead are
+ * rendered by every worker, nearest first; the rest of the file is filled in
+ * lazily by a single worker while the cache has room. Changing the pitch
+ * switches takes without restarting the workers, and takes rendered earlier
+ * are reused while they stay cached.
+ */
+class PreRenderer {
+public:
+    explicit PreRenderer (ThreadPolicy& threadPolicy);
+    ~PreRenderer();
+
+    /** Start rendering a file at the given pitch ratio. Cached takes of the file are reused. */
+    void start (const juce::File& file, float pitchRatio);
+
+    /** Switch the file being rendered to a new pitch ratio. */
+    void retune (float pitchRatio);
+
+    /** Stop rendering. Cached audio is kept for when the file is started again. */
+    void stop();
+
+    /** File currently being rendered. */
+    juce::File file() const;
+
+    /** Pitch ratio currently being rendered. */
+    float pitchRatio() const noexcept { return _pitchRatio.load(); }
+
+    /** Sample rate of the rendered audio, the same as the file's. */
+    double sampleRate() const noexcept { return _sampleRate.load(); }
+
+    /** Fraction of the current take rendered so far. */
+    double progress() const;
+
+    /** The cache holding rendered audio. */
+    RenderCache& cache() noexcept { return _cache; }
+
+    /** Move the playhead used to prioritise segments. Safe from any thread. */
+    void setPlayhead (juce::int64 position) noexcept { _playhead.store (position); }
+
+    /** Render only the given range, e.g. a loop region. Safe from any thread. */
+    void setFocus (juce::Range<juce::int64> range) noexcept;
+
+    /** Go back to rendering the whole file. */
+    void clearFocus() noexcept { setFocus ({ 0, std::numeric_limits<juce::int64>::max() }); }
+
+    /** Returns true if the given range of the current take can be read. Realtime safe. */
+    bool isRendered (juce::int64 startSample, int numSamples) const noexcept;
+
+    /**
+     * Copy rendered audio into a buffer. Realtime safe.
+     *
+     * Channels beyond those in the file repeat the file's last channel and samples
+     * past the end of the file are silent.
+     *
+     * @return false without touching the buffer if any of the range isn't rendered
+     */
+    bool read (juce::AudioBuffer<float>& dest, int destStartSample, juce::int64 startSample, int numSamples) const noexcept;
+
+private:
+    class RenderJob;
+
+    ThreadPolicy& _threadPolicy;
+    juce::AudioFormatManager _formatManager;
+    RenderCache _cache;
+    juce::ThreadPool _pool;
+    juce::WaitableEvent _wake;
+    Exporter::ExportSettings _settings;
+
+    // Guarded by the cache lock
+    juce::File _file;
+    juce::int64 _lengthInSamples { 0 };
+    std::shared_ptr<RenderCache::Take> _take;
+
+    std::atomic<float> _pitchRatio { 1.0f };
+    std::atomic<double> _sampleRate { 44100.0 };
+    std::atomic<juce::int64> _playhead { 0 };
+    std::atomic<juce::int64> _focusStart { 0 };
+    std::atomic<juce::int64> _focusEnd { std::numeric_limits<juce::int64>::max() };
+    std::atomic<int> _generation { 0 };
+
+    std::shared_ptr<RenderCache::Take> currentTake() const;
+    bool renderNext (juce::AudioFormatReader& reader, bool lazy, const std::function<bool()>& shouldExit);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PreRenderer)
+};
+
+} // namespace app
+} // namespace retuner
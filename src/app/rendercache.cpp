@@ -0,0 +1,287 @@
+// Copyright (c) 2025 Kushview, LLC
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "rendercache.hpp"
+
+namespace retuner {
+namespace app {
+
+namespace detail {
+/** Length of each independently rendered segment */
+static constexpr double segmentSeconds = 10.0;
+/** Cross-fade between neighbouring segments */
+static constexpr double overlapSeconds = 0.05;
+/** Context rendered and discarded either side of a segment */
+static constexpr double paddingSeconds = 1.0;
+
+inline static size_t defaultMemoryBudget()
+{
+    // A quarter of physical memory, capped at 2 GB
+    const auto systemBytes = static_cast<size_t> (juce::SystemStats::getMemorySizeInMegabytes()) * 1024 * 1024;
+    return juce::jlimit<size_t> (size_t (256) * 1024 * 1024, size_t (2048) * 1024 * 1024, systemBytes / 4);
+}
+} // namespace detail
+
+//==============================================================================
+RenderCache::Take::Take (const Key& key, juce::int64 lengthInSamples, double sampleRate)
+    : _key (key),
+      _lengthInSamples (lengthInSamples),
+      _sampleRate (sampleRate),
+      _segmentLength (juce::roundToInt (sampleRate * detail::segmentSeconds)),
+      _overlap (juce::roundToInt (sampleRate * detail::overlapSeconds)),
+      _padding (juce::roundToInt (sampleRate * detail::paddingSeconds))
+{
+    const auto numSegments = (_lengthInSamples + _segmentLength - 1) / _segmentLength;
+    for (juce::int64 i = 0; i < numSegments; ++i)
+        _segments.push_back (std::make_unique<Segment>());
+}
+
+int RenderCache::Take::regionLength (int index) const noexcept
+{
+    return static_cast<int> (juce::jmin<juce::int64> (_segmentLength, _lengthInSamples - segmentStart (index)));
+}
+
+int RenderCache::Take::fadeLength (int index) const noexcept
+{
+    return index > 0 ? juce::jmin (_overlap, regionLength (index)) : 0;
+}
+
+int RenderCache::Take::renderLength (int index) const noexcept
+{
+    // Render past the end of the region so the next segment can fade in over it
+    int length = regionLength (index);
+    if (index + 1 < numSegments())
+        length += fadeLength (index + 1);
+    return length;
+}
+
+bool RenderCache::Take::isSegmentReady (int index) const noexcept
+{
+    return _segments[(size_t) index]->state.load (std::memory_order_acquire) == segmentReady;
+}
+
+bool RenderCache::Take::isRendered (juce::int64 startSample, int numSamples) const noexcept
+{
+    if (startSample < 0 || _segments.empty())
+        return false;
+
+    const auto end = juce::jmin (startSample + numSamples, _lengthInSamples);
+    if (startSample >= end)
+        return true;
+
+    auto first = static_cast<int> (startSample / _segmentLength);
+    const auto last = static_cast<int> ((end - 1) / _segmentLength);
+
+    // The head of a segment is cross-faded with the tail of the one before it
+    if (startSample - segmentStart (first) < fadeLength (first))
+        --first;
+
+    for (int i = first; i <= last; ++i)
+        if (! isSegmentReady (i))
+            return false;
+
+    return true;
+}
+
+void RenderCache::Take::read (juce::AudioBuffer<float>& dest, int destStartSample, juce::int64 startSample, int numSamples) const noexcept
+{
+    jassert (isRendered (startSample, numSamples));
+    const int numDestChannels = dest.getNumChannels();
+
+    int done = 0;
+    while (done < numSamples) {
+        const auto position = startSample + done;
+
+        if (position >= _lengthInSamples) {
+            for (int ch = 0; ch < numDestChannels; ++ch)
+                dest.clear (ch, destStartSample + done, numSamples - done);
+            break;
+        }
+
+        const auto index = static_cast<int> (position / _segmentLength);
+        const auto& audio = _segments[(size_t) index]->audio;
+        const auto offset = static_cast<int> (position - segmentStart (index));
+        const auto fade = fadeLength (index);
+
+        int n = juce::jmin (numSamples - done, regionLength (index) - offset);
+        if (offset < fade)
+            n = juce::jmin (n, fade - offset);
+
+        for (int ch = 0; ch < numDestChannels; ++ch) {
+            auto* out = dest.getWritePointer (ch, destStartSample + done);
+            juce::FloatVectorOperations::copy (out, audio.getReadPointer (juce::jmin (ch, audio.getNumChannels() - 1), offset), n);
+
+            if (offset < fade) {
+                const auto& previous = _segments[(size_t) index - 1]->audio;
+                const auto* tail = previous.getReadPointer (juce::jmin (ch, previous.getNumChannels() - 1), _segmentLength + offset);
+                for (int i = 0; i < n; ++i) {
+                    const auto w = static_cast<float> (offset + i) / static_cast<float> (fade);
+                    out[i] = tail[i] + w * (out[i] - tail[i]);
+                }
+            }
+        }
+
+        done += n;
+    }
+}
+
+juce::int64 RenderCache::Take::distance (int index, juce::int64 playhead) const noexcept
+{
+    const auto start = segmentStart (index);
+    const auto end = start + _segmentLength;
+
+    // Work outward from the playhead, favouring what is about to play
+    return end <= playhead ? (playhead - end) * 4 + _segmentLength
+                           : juce::jmax<juce::int64> (0, start - playhead);
+}
+
+int RenderCache::Take::claim (juce::int64 playhead, juce::int64 maxDistance, juce::Range<juce::int64> range) noexcept
+{
+    for (;;) {
+        int best = -1;
+        auto bestDistance = maxDistance;
+
+        for (int i = 0; i < numSegments(); ++i) {
+            if (_segments[(size_t) i]->state.load() != segmentEmpty)
+                continue;
+            if (! range.intersects ({ segmentStart (i), segmentStart (i) + regionLength (i) }))
+                continue;
+
+            const auto d = distance (i, playhead);
+            if (d <= bestDistance) {
+                best = i;
+                bestDistance = d;
+            }
+        }
+
+        if (best < 0)
+            return -1;
+
+        int expected = segmentEmpty;
+        if (_segments[(size_t) best]->state.compare_exchange_strong (expected, segmentRendering))
+            return best;
+    }
+}
+
+void RenderCache::Take::finish (int index, juce::AudioBuffer<float>&& audio)
+{
+    auto& segment = *_segments[(size_t) index];
+    jassert (segment.state.load() == segmentRendering);
+
+    const auto bytes = static_cast<size_t> (audio.getNumChannels()) * static_cast<size_t> (audio.getNumSamples()) * sizeof (float);
+    segment.audio = std::move (audio);
+    _memoryUsage += bytes;
+    ++_numReady;
+    segment.state.store (segmentReady, std::memory_order_release);
+}
+
+void RenderCache::Take::release (int index) noexcept
+{
+    _segments[(size_t) index]->state.store (segmentEmpty);
+}
+
+void RenderCache::Take::fail (int index) noexcept
+{
+    _segments[(size_t) index]->state.store (segmentFailed);
+}
+
+void RenderCache::Take::evict (int index)
+{
+    auto& segment = *_segments[(size_t) index];
+    int expected = segmentReady;
+    if (! segment.state.compare_exchange_strong (expected, segmentEmpty))
+        return;
+
+    const auto bytes = static_cast<size_t> (segment.audio.getNumChannels()) * static_cast<size_t> (segment.audio.getNumSamples()) * sizeof (float);
+    segment.audio.setSize (0, 0);
+    _memoryUsage -= bytes;
+    --_numReady;
+}
+
+int RenderCache::Take::furthestReady (juce::int64 playhead) const noexcept
+{
+    int furthest = -1;
+    juce::int64 furthestDistance = -1;
+
+    for (int i = 0; i < numSegments(); ++i) {
+        if (! isSegmentReady (i))
+            continue;
+
+        const auto d = distance (i, playhead);
+        if (d > furthestDistance) {
+            furthest = i;
+            furthestDistance = d;
+        }
+    }
+
+    return furthest;
+}
+
+//==============================================================================
+RenderCache::RenderCache()
+    : _memoryBudget (detail::defaultMemoryBudget())
+{
+}
+
+std::shared_ptr<RenderCache::Take> RenderCache::acquire (const Key& key, juce::int64 lengthInSamples, double sampleRate)
+{
+    const juce::ScopedLock sl (_lock);
+
+    auto iter = std::find_if (_takes.begin(), _takes.end(), [&key] (const auto& t) { return t->key() == key; });
+    std::shared_ptr<Take> take;
+
+    if (iter != _takes.end()) {
+        take = *iter;
+        _takes.erase (iter);
+    } else {
+        take = std::make_shared<Take> (key, lengthInSamples, sampleRate);
+    }
+
+    _takes.push_back (take);
+    return take;
+}
+
+void RenderCache::trim (Take* playing, juce::int64 playhead)
+{
+    const juce::ScopedLock sl (_lock);
+
+    // Whole takes that aren't playing go first, least recently used first
+    for (auto iter = _takes.begin(); iter != _takes.end() && memoryUsage() > _memoryBudget;) {
+        if (iter->get() == playing) {
+            ++iter;
+            continue;
+        }
+
+        iter = _takes.erase (iter);
+    }
+
+    if (playing == nullptr)
+        return;
+
+    // Then whatever of the playing take is furthest from the playhead
+    while (memoryUsage() > _memoryBudget) {
+        const int index = playing->furthestReady (playhead);
+        if (index < 0)
+            break;
+        playing->evict (index);
+    }
+}
+
+void RenderCache::clear()
+{
+    const juce::ScopedLock sl (_lock);
+    _takes.clear();
+}
+
+size_t RenderCache::memoryUsage() const noexcept
+{
+    const juce::ScopedLock sl (_lock);
+
+    size_t total = 0;
+    for (const auto& take : _takes)
+        total += take->memoryUsage();
+    return total;
+}
+
+} // namespace app
+} // namespace retuner
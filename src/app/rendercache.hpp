@@ -0,0 +1,164 @@
+// Copyright (c) 2025 Kushview, LLC
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+#include "exporter.hpp"
+
+namespace retuner {
+namespace app {
+
+/**
+ * Segmented store of pre-rendered audio.
+ *
+ * Audio is grouped into takes, one per file, pitch ratio and quality. Each take
+ * is split into fixed length segments that are rendered independently. Takes
+ * other than the one playing are kept until the memory budget is needed, so
+ * going back to an earlier setting doesn't mean rendering it again.
+ *
+ * Structural changes (creating takes, evicting audio) happen under lock(). The
+ * audio thread reads the playing take while holding a try-lock on it.
+ */
+class RenderCache {
+public:
+    /** Identifies a take. Pitch ratios are compared to six decimal places. */
+    struct Key {
+        juce::File file;
+        juce::int64 ratio { 0 };
+        Exporter::Quality quality { Exporter::Quality::Maximum };
+
+        Key() = default;
+        Key (const juce::File& f, float pitchRatio, Exporter::Quality q)
+            : file (f), ratio (juce::roundToInt (pitchRatio * 1000000.0)), quality (q) {}
+
+        float pitchRatio() const noexcept { return static_cast<float> (ratio) / 1000000.0f; }
+        bool operator== (const Key& other) const noexcept { return file == other.file && ratio == other.ratio && quality == other.quality; }
+        bool operator!= (const Key& other) const noexcept { return ! operator== (other); }
+    };
+
+    /** Rendered segments for one key. */
+    class Take {
+    public:
+        Take (const Key& key, juce::int64 lengthInSamples, double sampleRate);
+
+        const Key& key() const noexcept { return _key; }
+        double sampleRate() const noexcept { return _sampleRate; }
+        juce::int64 lengthInSamples() const noexcept { return _lengthInSamples; }
+        int numSegments() const noexcept { return static_cast<int> (_segments.size()); }
+        int numReady() const noexcept { return _numReady.load(); }
+
+        /** First sample of a segment. */
+        juce::int64 segmentStart (int index) const noexcept { return static_cast<juce::int64> (index) * _segmentLength; }
+
+        /** Samples a segment must render: its own region plus the head of the next one. */
+        int renderLength (int index) const noexcept;
+
+        /** Context rendered and discarded either side of a segment. */
+        int padding() const noexcept { return _padding; }
+
+        /** Returns true if the given range can be read. Realtime safe. */
+        bool isRendered (juce::int64 startSample, int numSamples) const noexcept;
+
+        /** Copy rendered audio. The range must be rendered. Realtime safe. */
+        void read (juce::AudioBuffer<float>& dest, int destStartSample, juce::int64 startSample, int numSamples) const noexcept;
+
+        /**
+         * Claim the empty segment nearest the playhead for rendering.
+         * @param maxDistance Segments further than this from the playhead are ignored
+         * @param range       Only segments overlapping this range are considered
+         * @return The segment index or -1 if there's nothing to do
+         */
+        int claim (juce::int64 playhead, juce::int64 maxDistance,
+                   juce::Range<juce::int64> range = { 0, std::numeric_limits<juce::int64>::max() }) noexcept;
+
+        /** Store rendered audio for a claimed segment. */
+        void finish (int index, juce::AudioBuffer<float>&& audio);
+
+        /** Return a claimed segment unrendered, e.g. when cancelled. */
+        void release (int index) noexcept;
+
+        /** Mark a claimed segment as impossible to render so it isn't tried again. */
+        void fail (int index) noexcept;
+
+        /** Drop a segment's audio so it renders again if needed. Call under the cache lock. */
+        void evict (int index);
+
+        /** Playhead distance used to prioritise a segment. */
+        juce::int64 distance (int index, juce::int64 playhead) const noexcept;
+
+        /** Bytes of rendered audio held. */
+        size_t memoryUsage() const noexcept { return _memoryUsage.load(); }
+
+        /** Index of the ready segment furthest from the playhead, or -1. */
+        int furthestReady (juce::int64 playhead) const noexcept;
+
+    private:
+        enum SegmentState {
+            segmentEmpty = 0,
+            segmentRendering,
+            segmentReady,
+            segmentFailed
+        };
+
+        struct Segment {
+            std::atomic<int> state { segmentEmpty };
+            juce::AudioBuffer<float> audio;
+        };
+
+        Key _key;
+        juce::int64 _lengthInSamples;
+        double _sampleRate;
+        int _segmentLength;
+        int _overlap;
+        int _padding;
+        std::vector<std::unique_ptr<Segment>> _segments;
+        std::atomic<int> _numReady { 0 };
+        std::atomic<size_t> _memoryUsage { 0 };
+
+        int regionLength (int index) const noexcept;
+        int fadeLength (int index) const noexcept;
+        bool isSegmentReady (int index) const noexcept;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Take)
+    };
+
+    RenderCache();
+
+    /** Lock guarding take lifetime and evictions. */
+    const juce::CriticalSection& lock() const noexcept { return _lock; }
+
+    /** Find the take for a key, creating it if needed, and mark it most recently used. */
+    std::shared_ptr<Take> acquire (const Key& key, juce::int64 lengthInSamples, double sampleRate);
+
+    /** Returns true if there is room for another segment of the given size. */
+    bool hasRoomFor (size_t bytes) const noexcept { return memoryUsage() + bytes <= _memoryBudget; }
+
+    /**
+     * Free audio until the cache fits its budget. Takes not in use go first,
+     * least recently used first, then segments of the playing take furthest
+     * from the playhead.
+     */
+    void trim (Take* playing, juce::int64 playhead);
+
+    /** Drop every take. */
+    void clear();
+
+    /** Bytes of rendered audio held by all takes. */
+    size_t memoryUsage() const noexcept;
+
+    /** Change the memory budget in bytes. */
+    void setMemoryBudget (size_t bytes) noexcept { _memoryBudget = bytes; }
+    size_t memoryBudget() const noexcept { return _memoryBudget; }
+
+private:
+    juce::CriticalSection _lock;
+    std::vector<std::shared_ptr<Take>> _takes; // least recently used first
+    size_t _memoryBudget;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderCache)
+};
+
+} // namespace app
+} // namespace retuner
@@ -0,0 +1,260 @@
+// Copyright (c) 2025 Kushview, LLC
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "threadpolicy.hpp"
+
+#if JUCE_LINUX
+ #include <cerrno>
+ #include <cstring>
+ #include <pthread.h>
+ #include <sched.h>
+ #include <sys/resource.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+#endif
+
+namespace retuner {
+namespace app {
+
+namespace detail {
+/** SCHED_FIFO priority asked for the audio callback, capped by RLIMIT_RTPRIO */
+static constexpr int audioPriority = 80;
+/** Nice value of export threads while something plays */
+static constexpr int exportNice = 10;
+/** Best-effort I/O priority level of export threads while something plays, 7 being lowest */
+static constexpr int exportIoLevel = 7;
+
+#if JUCE_LINUX
+// From linux/ioprio.h, which isn't always installed
+static constexpr int ioprioClassShift = 13;
+static constexpr int ioprioClassBestEffort = 2;
+static constexpr int ioprioWhoProcess = 1;
+
+inline static int currentTid() noexcept
+{
+    return static_cast<int> (::syscall (SYS_gettid));
+}
+
+inline static bool setIoPriority (int tid, int ioprio) noexcept
+{
+    return ::syscall (SYS_ioprio_set, ioprioWhoProcess, tid, ioprio) == 0;
+}
+
+inline static juce::String errorText (int error)
+{
+    return juce::String (std::strerror (error));
+}
+#endif
+} // namespace detail
+
+//==============================================================================
+class ThreadPolicy::BackgroundClient : public juce::TimeSliceClient {
+public:
+    explicit BackgroundClient (ThreadPolicy& policy)
+        : _policy (policy) {}
+
+    int useTimeSlice() override
+    {
+        // Once is enough; a negative return takes the client off the thread
+        _policy.applyBackground();
+        return -1;
+    }
+
+private:
+    ThreadPolicy& _policy;
+};
+
+//==============================================================================
+ThreadPolicy::ThreadPolicy()
+{
+#if JUCE_LINUX
+    // Reserve the highest core the process may use. Core 0 tends to take
+    // more interrupts, and a single core can't be spared.
+    cpu_set_t allowed;
+    CPU_ZERO (&allowed);
+    if (::sched_getaffinity (0, sizeof (allowed), &allowed) == 0 && CPU_COUNT (&allowed) >= 2) {
+        for (int cpu = CPU_SETSIZE - 1; cpu >= 0; --cpu) {
+            if (CPU_ISSET (cpu, &allowed)) {
+                _audioCore = cpu;
+                break;
+            }
+        }
+    }
+#endif
+}
+
+void ThreadPolicy::applyAudio() noexcept
+{
+    // Devices may call back on a new thread after restarting
+    const auto thread = juce::Thread::getCurrentThreadId();
+    if (_audioThread.load() == thread)
+        return;
+    _audioThread = thread;
+
+#if JUCE_LINUX
+    int result = audioApplied;
+
+    // Drivers like JACK make their threads realtime already
+    int policy = SCHED_OTHER;
+    sched_param param {};
+    ::pthread_getschedparam (::pthread_self(), &policy, &param);
+    if (policy != SCHED_FIFO && policy != SCHED_RR) {
+        rlimit limit {};
+        auto priority = detail::audioPriority;
+        if (::getrlimit (RLIMIT_RTPRIO, &limit) == 0 && limit.rlim_cur > 0 && limit.rlim_cur != RLIM_INFINITY)
+            priority = juce::jmin (priority, static_cast<int> (limit.rlim_cur));
+
+        // Without an RLIMIT_RTPRIO this only succeeds with CAP_SYS_NICE
+        param.sched_priority = priority;
+        if (::pthread_setschedparam (::pthread_self(), SCHED_FIFO, &param) != 0)
+            result |= audioPriorityDenied;
+    }
+
+    if (_audioCore >= 0) {
+        cpu_set_t set;
+        CPU_ZERO (&set);
+        CPU_SET (_audioCore, &set);
+        if (::pthread_setaffinity_np (::pthread_self(), sizeof (set), &set) != 0)
+            result |= audioAffinityDenied;
+    }
+
+    _audioResult = result;
+#endif
+}
+
+void ThreadPolicy::applyBackground()
+{
+#if JUCE_LINUX
+    if (_audioCore < 0)
+        return;
+
+    cpu_set_t set;
+    CPU_ZERO (&set);
+    if (::sched_getaffinity (0, sizeof (set), &set) != 0)
+        return;
+    CPU_CLR (_audioCore, &set);
+
+    const auto error = ::pthread_setaffinity_np (::pthread_self(), sizeof (set), &set);
+    if (error != 0) {
+        auto* thread = juce::Thread::getCurrentThread();
+        addProblem ("Could not keep " + (thread != nullptr ? thread->getThreadName() : juce::String ("a background thread"))
+                    + " off the audio core: " + detail::errorText (error));
+    }
+#endif
+}
+
+void ThreadPolicy::applyBackground (juce::TimeSliceThread& thread)
+{
+    auto* client = _clients.add (new BackgroundClient (*this));
+    thread.addTimeSliceClient (client);
+}
+
+void ThreadPolicy::enterExport()
+{
+    applyBackground();
+
+#if JUCE_LINUX
+    Export thread;
+    thread.tid = detail::currentTid();
+    errno = 0;
+    thread.nice = ::getpriority (PRIO_PROCESS, static_cast<id_t> (thread.tid));
+    if (errno != 0)
+        thread.nice = 0;
+
+    const juce::ScopedLock sl (_lock);
+    _exports.add (thread);
+    if (_playing)
+        lowerExport (_exports.getReference (_exports.size() - 1), true);
+#endif
+}
+
+void ThreadPolicy::leaveExport()
+{
+#if JUCE_LINUX
+    const auto tid = detail::currentTid();
+    const juce::ScopedLock sl (_lock);
+    for (int i = _exports.size(); --i >= 0;)
+        if (_exports.getReference (i).tid == tid)
+            _exports.remove (i);
+#endif
+}
+
+void ThreadPolicy::setPlaybackActive (bool playing)
+{
+    const juce::ScopedLock sl (_lock);
+    if (playing == _playing)
+        return;
+
+    _playing = playing;
+    for (auto& thread : _exports)
+        lowerExport (thread, playing);
+}
+
+void ThreadPolicy::lowerExport (Export& thread, bool lower)
+{
+#if JUCE_LINUX
+    if (thread.lowered == lower)
+        return;
+
+    // Another thread's priorities can be changed through its kernel id
+    const auto tid = static_cast<id_t> (thread.tid);
+    if (lower) {
+        if (::setpriority (PRIO_PROCESS, tid, juce::jmax (thread.nice, detail::exportNice)) != 0)
+            addProblem ("Could not lower the export's CPU priority: " + detail::errorText (errno));
+        if (! detail::setIoPriority (thread.tid, (detail::ioprioClassBestEffort << detail::ioprioClassShift) | detail::exportIoLevel))
+            addProblem ("Could not lower the export's I/O priority: " + detail::errorText (errno));
+    } else {
+        // Unprivileged processes may not be allowed to raise it again (see RLIMIT_NICE)
+        if (::setpriority (PRIO_PROCESS, tid, thread.nice) != 0)
+            addProblem ("Could not restore the export's CPU priority after playback: " + detail::errorText (errno));
+        detail::setIoPriority (thread.tid, 0); // back to following the nice value
+    }
+
+    thread.lowered = lower;
+#else
+    juce::ignoreUnused (thread, lower);
+#endif
+}
+
+void ThreadPolicy::addProblem (const juce::String& problem)
+{
+    const juce::ScopedLock sl (_lock);
+    if (! _problems.contains (problem))
+        _problems.add (problem);
+}
+
+void ThreadPolicy::collectAudioProblems()
+{
+    // The audio thread only leaves flags; messages are made here
+    const auto result = _audioResult.load();
+    if (result == _audioReported)
+        return;
+    _audioReported = result;
+
+    if ((result & audioPriorityDenied) != 0)
+        addProblem ("The audio thread could not get realtime priority. Raise RLIMIT_RTPRIO for this user, for example by joining the audio group.");
+    if ((result & audioAffinityDenied) != 0)
+        addProblem ("The audio thread could not be given a core of its own");
+}
+
+juce::StringArray ThreadPolicy::problems()
+{
+    const juce::ScopedLock sl (_lock);
+    collectAudioProblems();
+    return _problems;
+}
+
+juce::StringArray ThreadPolicy::takeNewProblems()
+{
+    const juce::ScopedLock sl (_lock);
+    collectAudioProblems();
+
+    juce::StringArray result;
+    for (int i = _numTaken; i < _problems.size(); ++i)
+        result.add (_problems[i]);
+    _numTaken = _problems.size();
+    return result;
+}
+
+} // namespace app
+} // namespace retuner
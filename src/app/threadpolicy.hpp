@@ -0,0 +1,89 @@
+// Copyright (c) 2025 Kushview, LLC
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+namespace retuner {
+namespace app {
+
+/**
+ * Scheduling policy for the app's threads, so export and analysis work
+ * doesn't compete with the audio callback for the same core.
+ *
+ * The audio callback asks for realtime priority and is pinned to a core of
+ * its own, the highest one the process may use. Background threads keep off
+ * that core, and export threads drop to a low CPU and I/O priority while
+ * anything plays.
+ *
+ * Everything is best effort. Realtime priority and raising a priority back
+ * up need permissions many desktop systems don't grant, so whatever couldn't
+ * be applied is collected in problems() instead of failing. Only Linux is
+ * handled; elsewhere the OS already schedules audio threads well and nothing
+ * is changed.
+ */
+class ThreadPolicy {
+public:
+    ThreadPolicy();
+    ~ThreadPolicy() = default;
+
+    /** Call from the audio callback. Only the first call on each thread does
+        anything, so this is cheap enough to call every block. */
+    void applyAudio() noexcept;
+
+    /** Call once from a background thread. */
+    void applyBackground();
+
+    /** Apply the background policy on a time slice thread from its next slice. */
+    void applyBackground (juce::TimeSliceThread& thread);
+
+    /** Call from an export thread when it starts, and leaveExport() before it ends. */
+    void enterExport();
+    void leaveExport();
+
+    /** Lower running exports while playing and restore them afterwards. */
+    void setPlaybackActive (bool playing);
+
+    /** What couldn't be applied so far. */
+    juce::StringArray problems();
+
+    /** Problems found since the last call. */
+    juce::StringArray takeNewProblems();
+
+private:
+    enum AudioResult {
+        audioApplied = 1 << 0,
+        audioPriorityDenied = 1 << 1,
+        audioAffinityDenied = 1 << 2
+    };
+
+    struct Export {
+        int tid { 0 };
+        int nice { 0 }; // to restore
+        bool lowered { false };
+    };
+
+    class BackgroundClient;
+    juce::OwnedArray<juce::TimeSliceClient> _clients;
+
+    int _audioCore { -1 }; // -1 if there are too few cores to reserve one
+    std::atomic<juce::Thread::ThreadID> _audioThread { nullptr };
+    std::atomic<int> _audioResult { 0 };
+    int _audioReported { 0 };
+
+    juce::CriticalSection _lock;
+    juce::Array<Export> _exports;
+    bool _playing { false };
+    juce::StringArray _problems;
+    int _numTaken { 0 };
+
+    void addProblem (const juce::String& problem);
+    void collectAudioProblems();
+    void lowerExport (Export& thread, bool lower);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ThreadPolicy)
+};
+
+} // namespace app
+} // namespace retuner
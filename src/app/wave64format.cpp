@@ -0,0 +1,328 @@
+// Copyright (c) 2025 Kushview, LLC
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "wave64format.hpp"
+
+namespace retuner {
+namespace app {
+
+namespace detail {
+static const char* const wave64FormatName = "Wave64 file";
+
+/** Chunk IDs are GUIDs, stored as Windows lays them out in memory */
+static const juce::uint8 riffGuid[16] = { 0x72, 0x69, 0x66, 0x66, 0x2e, 0x91, 0xcf, 0x11, 0xa5, 0xd6, 0x28, 0xdb, 0x04, 0xc1, 0x00, 0x00 };
+static const juce::uint8 waveGuid[16] = { 0x77, 0x61, 0x76, 0x65, 0xf3, 0xac, 0xd3, 0x11, 0x8c, 0xd1, 0x00, 0xc0, 0x4f, 0x8e, 0xdb, 0x8a };
+static const juce::uint8 fmtGuid[16] = { 0x66, 0x6d, 0x74, 0x20, 0xf3, 0xac, 0xd3, 0x11, 0x8c, 0xd1, 0x00, 0xc0, 0x4f, 0x8e, 0xdb, 0x8a };
+static const juce::uint8 dataGuid[16] = { 0x64, 0x61, 0x74, 0x61, 0xf3, 0xac, 0xd3, 0x11, 0x8c, 0xd1, 0x00, 0xc0, 0x4f, 0x8e, 0xdb, 0x8a };
+
+/** KSDATAFORMAT_SUBTYPE_PCM, with the format tag in its first two bytes */
+static const juce::uint8 subFormatGuid[16] = { 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71 };
+
+static constexpr int pcmTag = 1;
+static constexpr int floatTag = 3;
+static constexpr int extensibleTag = 0xfffe;
+
+/** GUID and 64-bit size opening every chunk; sizes include it */
+static constexpr juce::int64 chunkHeaderBytes = 24;
+
+/** WAVE_FORMAT_EXTENSIBLE body of the fmt chunk */
+static constexpr juce::int64 fmtBodyBytes = 40;
+
+/** riff header, fmt chunk and data chunk header, as the writer lays them out */
+static constexpr juce::int64 headerBytes = 40 + chunkHeaderBytes + fmtBodyBytes + chunkHeaderBytes;
+
+/** Frames converted at a time */
+static constexpr int framesPerBlock = 4096;
+
+inline static juce::int64 align8 (juce::int64 size) noexcept { return (size + 7) & ~juce::int64 (7); }
+
+inline static bool readGuid (juce::InputStream& in, const juce::uint8 (&guid)[16])
+{
+    juce::uint8 id[16];
+    return in.read (id, 16) == 16 && std::memcmp (id, guid, 16) == 0;
+}
+} // namespace detail
+
+//==============================================================================
+class Wave64Reader : public juce::AudioFormatReader {
+public:
+    explicit Wave64Reader (juce::InputStream* in)
+        : juce::AudioFormatReader (in, detail::wave64FormatName)
+    {
+        if (! detail::readGuid (*input, detail::riffGuid))
+            return;
+        input->readInt64();
+        if (! detail::readGuid (*input, detail::waveGuid))
+            return;
+
+        int tag = 0, blockAlign = 0;
+        juce::int64 dataBytes = 0;
+
+        while (! input->isExhausted()) {
+            const auto chunkStart = input->getPosition();
+            juce::uint8 id[16];
+            if (input->read (id, 16) != 16)
+                break;
+
+            const auto size = input->readInt64();
+            if (size < detail::chunkHeaderBytes)
+                break;
+
+            if (std::memcmp (id, detail::fmtGuid, 16) == 0) {
+                tag = static_cast<juce::uint16> (input->readShort());
+                numChannels = static_cast<unsigned int> (input->readShort());
+                sampleRate = static_cast<double> (input->readInt());
+                input->readInt(); // bytes per second
+                blockAlign = input->readShort();
+                bitsPerSample = static_cast<unsigned int> (input->readShort());
+
+                if (tag == detail::extensibleTag && size >= detail::chunkHeaderBytes + detail::fmtBodyBytes) {
+                    input->skipNextBytes (8); // extension size, valid bits, channel mask
+                    juce::uint8 subFormat[16];
+                    input->read (subFormat, 16);
+                    tag = subFormat[0] | (subFormat[1] << 8);
+                }
+            } else if (std::memcmp (id, detail::dataGuid, 16) == 0) {
+                _dataStart = chunkStart + detail::chunkHeaderBytes;
+
+                // A writer that stopped before filling in the size leaves it
+                // empty; the audio runs to the end of the file then
+                dataBytes = size > detail::chunkHeaderBytes ? size - detail::chunkHeaderBytes
+                                                            : input->getTotalLength() - _dataStart;
+                if (size == detail::chunkHeaderBytes)
+                    break;
+            }
+
+            if (! input->setPosition (chunkStart + detail::align8 (size)))
+                break;
+        }
+
+        usesFloatingPointData = tag == detail::floatTag;
+        const bool supported = (tag == detail::pcmTag && (bitsPerSample == 16 || bitsPerSample == 24))
+                               || (tag == detail::floatTag && bitsPerSample == 32);
+
+        _bytesPerFrame = static_cast<int> (numChannels * bitsPerSample / 8);
+        if (supported && numChannels > 0 && blockAlign == _bytesPerFrame && _dataStart > 0)
+            lengthInSamples = dataBytes / _bytesPerFrame;
+        else
+            numChannels = 0;
+    }
+
+    bool isValid() const noexcept { return numChannels > 0; }
+
+    bool readSamples (int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                      juce::int64 startSampleInFile, int numSamples) override
+    {
+        clearSamplesBeyondAvailableLength (destChannels, numDestChannels, startOffsetInDestBuffer,
+                                           startSampleInFile, numSamples, lengthInSamples);
+        if (numSamples <= 0)
+            return true;
+
+        if (! input->setPosition (_dataStart + startSampleInFile * _bytesPerFrame))
+            return false;
+
+        _block.ensureSize (static_cast<size_t> (detail::framesPerBlock * _bytesPerFrame));
+        while (numSamples > 0) {
+            const int n = juce::jmin (numSamples, detail::framesPerBlock);
+            const int bytes = n * _bytesPerFrame;
+            const int got = input->read (_block.getData(), bytes);
+            if (got < bytes)
+                juce::zeromem (juce::addBytesToPointer (_block.getData(), juce::jmax (0, got)), static_cast<size_t> (bytes - juce::jmax (0, got)));
+
+            copySamples (destChannels, startOffsetInDestBuffer, numDestChannels, n);
+            startOffsetInDestBuffer += n;
+            numSamples -= n;
+        }
+
+        return true;
+    }
+
+private:
+    juce::int64 _dataStart { 0 };
+    int _bytesPerFrame { 0 };
+    juce::MemoryBlock _block;
+
+    void copySamples (int* const* dest, int destOffset, int numDestChannels, int numFrames) const noexcept
+    {
+        using namespace juce;
+        const auto* source = _block.getData();
+        const auto channels = static_cast<int> (numChannels);
+
+        switch (bitsPerSample) {
+            case 16:
+                ReadHelper<AudioData::Int32, AudioData::Int16, AudioData::LittleEndian>::read (dest, destOffset, numDestChannels, source, channels, numFrames);
+                break;
+            case 24:
+                ReadHelper<AudioData::Int32, AudioData::Int24, AudioData::LittleEndian>::read (dest, destOffset, numDestChannels, source, channels, numFrames);
+                break;
+            default:
+                ReadHelper<AudioData::Float32, AudioData::Float32, AudioData::LittleEndian>::read (dest, destOffset, numDestChannels, source, channels, numFrames);
+                break;
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Wave64Reader)
+};
+
+//==============================================================================
+class Wave64Writer : public juce::AudioFormatWriter {
+public:
+    Wave64Writer (juce::OutputStream* out, double rate, unsigned int channels, unsigned int bits)
+        : juce::AudioFormatWriter (out, detail::wave64FormatName, rate, channels, bits)
+    {
+        usesFloatingPointData = bits == 32;
+        _bytesPerFrame = static_cast<int> (channels * bits / 8);
+        _headerStart = output->getPosition();
+        _ok = writeHeader();
+    }
+
+    ~Wave64Writer() override
+    {
+        // Pad the data out to a whole chunk, then fill in the final sizes
+        if (_ok && output->setPosition (_headerStart + detail::headerBytes + _dataBytes)) {
+            const auto padding = static_cast<size_t> (detail::align8 (_dataBytes) - _dataBytes);
+            if (padding > 0)
+                output->writeRepeatedByte (0, padding);
+            _padded = true;
+            writeHeader();
+        }
+    }
+
+    bool write (const int** data, int numSamples) override
+    {
+        if (! _ok)
+            return false;
+
+        // Convert and interleave a block at a time straight into one buffer
+        _block.ensureSize (static_cast<size_t> (detail::framesPerBlock * _bytesPerFrame));
+        for (int done = 0; done < numSamples;) {
+            const int n = juce::jmin (numSamples - done, detail::framesPerBlock);
+            convert (data, done, n);
+            if (! output->write (_block.getData(), static_cast<size_t> (n * _bytesPerFrame)))
+                return _ok = false;
+
+            _dataBytes += static_cast<juce::int64> (n) * _bytesPerFrame;
+            done += n;
+        }
+
+        return true;
+    }
+
+    bool flush() override
+    {
+        const auto position = output->getPosition();
+        if (! _ok || ! writeHeader() || ! output->setPosition (position))
+            return false;
+
+        output->flush();
+        return true;
+    }
+
+private:
+    juce::int64 _headerStart { 0 };
+    juce::int64 _dataBytes { 0 };
+    int _bytesPerFrame { 0 };
+    bool _ok { false };
+    bool _padded { false };
+    juce::MemoryBlock _block;
+
+    void convert (const int** data, int offset, int numFrames)
+    {
+        using namespace juce;
+        auto* dest = _block.getData();
+        const auto channels = static_cast<int> (numChannels);
+
+        switch (bitsPerSample) {
+            case 16:
+                WriteHelper<AudioData::Int16, AudioData::Int32, AudioData::LittleEndian>::write (dest, channels, data, numFrames, offset);
+                break;
+            case 24:
+                WriteHelper<AudioData::Int24, AudioData::Int32, AudioData::LittleEndian>::write (dest, channels, data, numFrames, offset);
+                break;
+            default:
+                WriteHelper<AudioData::Float32, AudioData::Float32, AudioData::LittleEndian>::write (dest, channels, data, numFrames, offset);
+                break;
+        }
+    }
+
+    /** Write the header with the sizes as they stand; it's always the same length. */
+    bool writeHeader()
+    {
+        if (! output->setPosition (_headerStart))
+            return false;
+
+        const auto dataChunk = detail::chunkHeaderBytes + _dataBytes;
+        const auto riffSize = detail::headerBytes + (_padded ? detail::align8 (_dataBytes) : _dataBytes);
+        const auto tag = usesFloatingPointData ? detail::floatTag : detail::pcmTag;
+        const int channelMask = numChannels == 1 ? 0x4 : numChannels == 2 ? 0x3 : 0;
+
+        juce::uint8 subFormat[16];
+        std::memcpy (subFormat, detail::subFormatGuid, 16);
+        subFormat[0] = static_cast<juce::uint8> (tag);
+
+        return output->write (detail::riffGuid, 16)
+               && output->writeInt64 (riffSize)
+               && output->write (detail::waveGuid, 16)
+               && output->write (detail::fmtGuid, 16)
+               && output->writeInt64 (detail::chunkHeaderBytes + detail::fmtBodyBytes)
+               && output->writeShort (static_cast<short> (detail::extensibleTag))
+               && output->writeShort (static_cast<short> (numChannels))
+               && output->writeInt (juce::roundToInt (sampleRate))
+               && output->writeInt (juce::roundToInt (sampleRate) * _bytesPerFrame)
+               && output->writeShort (static_cast<short> (_bytesPerFrame))
+               && output->writeShort (static_cast<short> (bitsPerSample))
+               && output->writeShort (22) // extension size
+               && output->writeShort (static_cast<short> (bitsPerSample))
+               && output->writeInt (channelMask)
+               && output->write (subFormat, 16)
+               && output->write (detail::dataGuid, 16)
+               && output->writeInt64 (dataChunk);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Wave64Writer)
+};
+
+//==============================================================================
+Wave64AudioFormat::Wave64AudioFormat()
+    : juce::AudioFormat (detail::wave64FormatName, ".w64")
+{
+}
+
+Wave64AudioFormat::~Wave64AudioFormat() = default;
+
+juce::Array<int> Wave64AudioFormat::getPossibleSampleRates()
+{
+    return { 8000, 11025, 16000, 22050, 32000, 44100, 48000, 88200, 96000, 176400, 192000, 352800, 384000 };
+}
+
+juce::Array<int> Wave64AudioFormat::getPossibleBitDepths()
+{
+    return { 16, 24, 32 };
+}
+
+juce::AudioFormatReader* Wave64AudioFormat::createReaderFor (juce::InputStream* sourceStream, bool deleteStreamIfOpeningFails)
+{
+    auto reader = std::make_unique<Wave64Reader> (sourceStream);
+    if (reader->isValid())
+        return reader.release();
+
+    if (! deleteStreamIfOpeningFails)
+        reader->input = nullptr;
+
+    return nullptr;
+}
+
+std::unique_ptr<juce::AudioFormatWriter> Wave64AudioFormat::createWriterFor (std::unique_ptr<juce::OutputStream>& streamToWriteTo,
+                                                                             const juce::AudioFormatWriterOptions& options)
+{
+    if (streamToWriteTo == nullptr || ! getPossibleBitDepths().contains (options.getBitsPerSample()) || options.getNumChannels() <= 0)
+        return nullptr;
+
+    return std::make_unique<Wave64Writer> (streamToWriteTo.release(),
+                                           options.getSampleRate(),
+                                           static_cast<unsigned int> (options.getNumChannels()),
+                                           static_cast<unsigned int> (options.getBitsPerSample()));
+}
+
+} // namespace app
+} // namespace retuner
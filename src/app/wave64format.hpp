@@ -0,0 +1,42 @@
+// Copyright (c) 2025 Kushview, LLC
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_core/juce_core.h>
+
+namespace retuner {
+namespace app {
+
+/**
+ * Sony Wave64 (.w64) files: WAV audio with 64-bit chunk sizes, so there's no
+ * 4 GB limit on the data.
+ *
+ * Reads and writes 16 and 24-bit integer and 32-bit float PCM. The writer
+ * streams: the header goes out first with empty sizes, which are filled in
+ * on every flush() and when the writer is deleted, so even an interrupted
+ * export leaves a playable file up to its last flush.
+ */
+class Wave64AudioFormat : public juce::AudioFormat {
+public:
+    Wave64AudioFormat();
+    ~Wave64AudioFormat() override;
+
+    juce::Array<int> getPossibleSampleRates() override;
+    juce::Array<int> getPossibleBitDepths() override;
+    bool canDoStereo() override { return true; }
+    bool canDoMono() override { return true; }
+
+    juce::AudioFormatReader* createReaderFor (juce::InputStream* sourceStream, bool deleteStreamIfOpeningFails) override;
+
+    /** 32 bits per sample writes float, as WAV does. */
+    std::unique_ptr<juce::AudioFormatWriter> createWriterFor (std::unique_ptr<juce::OutputStream>& streamToWriteTo,
+                                                              const juce::AudioFormatWriterOptions& options) override;
+
+private:
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Wave64AudioFormat)
+};
+
+} // namespace app
+} // namespace retuner
@@ -57,7 +57,17 @@ void Processor::prepareToPlay (double sampleRate_, int samplesPerBlock)
     spec.maximumBlockSize = static_cast<juce::uint32> (samplesPerBlock);
     spec.numChannels = static_cast<juce::uint32> (juce::jmax (getTotalNumInputChannels(), getTotalNumOutputChannels()));
 
-    _pitchShifter.prepare (spec);
+    _pitchShifters[0].prepare (spec);
+    _activeShifter = 0;
+    _seekFadeRemaining = 0;
+
+    // The spare only costs memory where seeks need it
+    if (_seekCrossfade) {
+        _pitchShifters[1].prepare (spec);
+        _seekFadeBuffer.setSize (static_cast<int> (spec.numChannels), samplesPerBlock);
+    } else {
+        _seekFadeBuffer.setSize (0, 0);
+    }
 
     _smoothGain.reset (sampleRate_, 0.2);
     const auto gain = juce::Decibels::decibelsToGain (_parameters.getRawParameterValue (params::VOLUME_DB)->load());
@@ -66,13 +76,14 @@ void Processor::prepareToPlay (double sampleRate_, int samplesPerBlock)
 
 void Processor::releaseResources()
 {
-    _pitchShifter.reset();
+    for (auto& shifter : _pitchShifters)
+        shifter.reset();
+    _seekFadeRemaining = 0;
 }
 
 void Processor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer&)
 {
     juce::ScopedNoDenormals noDenormals;
-    const int numSamples = buffer.getNumSamples();
     const auto totalNumInputChannels = getTotalNumInputChannels();
     const auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -80,16 +91,27 @@ void Processor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
+    processPitch (buffer);
+    processGain (buffer);
+}
+
+void Processor::processPitch (juce::AudioBuffer<float>& buffer) noexcept
+{
     // Get current parameter values
     const auto sourceFreq = _sourceA4Freq->load();
     const auto targetFreq = _targetA4Freq->load();
 
-    _pitchShifter.setPitchRatio (targetFreq / sourceFreq);
+    pitchShifter().setPitchRatio (targetFreq / sourceFreq);
 
     // Process audio through pitch shifter
     juce::dsp::AudioBlock<float> block (buffer);
     juce::dsp::ProcessContextReplacing<float> context (block);
-    _pitchShifter.process (context);
+    pitchShifter().process (context);
+}
+
+void Processor::processGain (juce::AudioBuffer<float>& buffer) noexcept
+{
+    const int numSamples = buffer.getNumSamples();
 
     // Apply smoothed volume gain - check for target changes in a thread-safe way
     const auto targetGain = _targetGain.load();
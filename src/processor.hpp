@@ -44,14 +44,122 @@ public:
 
     auto& parameters() noexcept { return _parameters; }
 
+    /** Runs only the pitch stage in place. Used by the standalone engine, which
+        may mix the realtime pitch stage with pre-rendered audio before the gain stage. */
+    void processPitch (juce::AudioBuffer<float>& buffer) noexcept;
+
+    /** Pull-mode pitch stage, filling the buffer from input read through @p readInput
+        at the rate set with setResampleRatio(). @see RubberBandShifter::process */
+    template <typename InputFunction>
+    void processPitch (juce::AudioBuffer<float>& buffer, InputFunction&& readInput) noexcept
+    {
+        const auto ratio = pitchRatio();
+        const int numSamples = buffer.getNumSamples();
+
+        pitchShifter().setPitchRatio (ratio);
+        pitchShifter().process (buffer.getArrayOfWritePointers(), buffer.getNumChannels(), numSamples, std::forward<InputFunction> (readInput));
+
+        if (_seekFadeRemaining <= 0)
+            return;
+
+        // Fade out what the previous stretcher still holds from before the seek,
+        // flushing it with silence
+        auto& previous = _pitchShifters[(size_t) (1 - _activeShifter)];
+        const int numChannels = juce::jmin (buffer.getNumChannels(), _seekFadeBuffer.getNumChannels());
+        const int n = juce::jmin (numSamples, _seekFadeBuffer.getNumSamples());
+        previous.setPitchRatio (ratio);
+        previous.process (_seekFadeBuffer.getArrayOfWritePointers(), numChannels, n, [] (float* const* input, int numInputChannels, int numInput) {
+            for (int ch = 0; ch < numInputChannels; ++ch)
+                juce::FloatVectorOperations::clear (input[ch], numInput);
+        });
+
+        const float step = 1.0f / static_cast<float> (seekFadeSamples);
+        int remaining = _seekFadeRemaining;
+        for (int ch = 0; ch < numChannels; ++ch) {
+            auto* out = buffer.getWritePointer (ch);
+            const auto* old = _seekFadeBuffer.getReadPointer (ch);
+            remaining = _seekFadeRemaining;
+            for (int i = 0; i < n && remaining > 0; ++i, --remaining)
+                out[i] += (static_cast<float> (remaining) * step) * (old[i] - out[i]);
+        }
+        _seekFadeRemaining = remaining;
+    }
+
+    /**
+     * Restarts the pitch stage at a new position without its start delay.
+     *
+     * The spare stretcher takes over, pre-rolled from @p readInput with the
+     * prerollLength() samples leading up to the new position. The previous
+     * stretcher's output is cross-faded out over the next few pull-mode
+     * blocks. Without a spare (see setSeekCrossfade()) the stretcher is
+     * pre-rolled in place and there's no cross-fade.
+     */
+    template <typename InputFunction>
+    void seekPitch (InputFunction&& readInput) noexcept
+    {
+        if (_seekFadeBuffer.getNumSamples() > 0) {
+            _activeShifter = 1 - _activeShifter;
+            _seekFadeRemaining = seekFadeSamples;
+        }
+
+        pitchShifter().setPitchRatio (pitchRatio());
+        pitchShifter().preroll (std::forward<InputFunction> (readInput));
+    }
+
+    /** Input samples seekPitch() pre-rolls with. */
+    int pitchPrerollLength() const noexcept { return pitchShifter().prerollLength(); }
+
+    /** Keep a spare stretcher so seekPitch() can cross-fade. Takes effect from the next prepareToPlay(). */
+    void setSeekCrossfade (bool enabled) noexcept { _seekCrossfade = enabled; }
+
+    /** Trade some quality for the least latency, for live input. Takes effect from the next prepareToPlay(). */
+    void setLowLatency (bool enabled) noexcept
+    {
+        for (auto& shifter : _pitchShifters)
+            shifter.setLowLatency (enabled);
+    }
+
+    /** Folds sample rate conversion into the pitch stage, as output over input rate.
+        Anything other than 1.0 needs the pull-mode processPitch(). */
+    void setResampleRatio (double ratio) noexcept
+    {
+        for (auto& shifter : _pitchShifters)
+            shifter.setResampleRatio (ratio);
+    }
+
+    /** Applies the smoothed output gain in place. */
+    void processGain (juce::AudioBuffer<float>& buffer) noexcept;
+
+    /** Clears the pitch stage so it starts fresh from the next block. */
+    void resetPitch() noexcept
+    {
+        pitchShifter().reset();
+        _seekFadeRemaining = 0;
+    }
+
+    /** Returns the latency of the pitch stage in samples at the prepared rate. */
+    int pitchLatency() const noexcept { return pitchShifter().latency(); }
+
+    /** Returns the current target/source pitch ratio. */
+    float pitchRatio() const noexcept { return _targetA4Freq->load() / _sourceA4Freq->load(); }
+
 private:
     juce::AudioProcessorValueTreeState _parameters;
     int _program { 0 };
     double _sampleRate = 44100.0;
     int _samplesPerBlock = 512;
 
-    // DSP Chain
-    retuner::dsp::RubberBandShifter<float> _pitchShifter;
+    // DSP Chain. The second stretcher is a spare for cross-fading seeks.
+    std::array<retuner::dsp::RubberBandShifter<float>, 2> _pitchShifters;
+    int _activeShifter { 0 };
+    bool _seekCrossfade { false };
+
+    static constexpr int seekFadeSamples = 512;
+    juce::AudioBuffer<float> _seekFadeBuffer;
+    int _seekFadeRemaining { 0 };
+
+    retuner::dsp::RubberBandShifter<float>& pitchShifter() noexcept { return _pitchShifters[(size_t) _activeShifter]; }
+    const retuner::dsp::RubberBandShifter<float>& pitchShifter() const noexcept { return _pitchShifters[(size_t) _activeShifter]; }
 
     // Parameter pointers
     std::atomic<float>* _sourceA4Freq { nullptr };
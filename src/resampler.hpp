@@ -0,0 +1,326 @@
+// Copyright (c) 2025 Kushview, LLC
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define RETUNER_RESAMPLER_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define RETUNER_RESAMPLER_NEON 1
+#endif
+
+namespace retuner {
+namespace dsp {
+
+/**
+ * Windowed-sinc polyphase sample rate converter.
+ *
+ * Each output sample is the dot product of the input with one filter from a
+ * table of Kaiser windowed sincs, one per fractional position ("phase").
+ * Positions between phases interpolate the two nearest filters. The dot
+ * products use SSE or NEON where available, with a scalar fallback.
+ *
+ * Output is aligned with the input: output sample n corresponds to input
+ * position n * inputRate / outputRate. The filter looks ahead by half its
+ * length, so process() asks for that much more input than it has produced
+ * output for; feed silence to flush the end of a stream.
+ */
+class Resampler {
+public:
+    /** Filter length and phase resolution */
+    enum class Quality {
+        Draft,    ///< 8 taps, nearest phase
+        Standard, ///< 16 taps
+        High,     ///< 32 taps
+        Maximum   ///< 64 taps
+    };
+
+    Resampler() = default;
+
+    //==============================================================================
+    /**
+     * Prepare for a conversion. Allocates, so call it before processing starts.
+     * @param maxOutputBlock Most samples asked of a single process() call
+     */
+    void prepare (double inputRate, double outputRate, int numChannels, int maxOutputBlock, Quality quality = Quality::High)
+    {
+        jassert (inputRate > 0.0 && outputRate > 0.0 && numChannels > 0 && maxOutputBlock > 0);
+
+        _step = inputRate / outputRate;
+        _numChannels = numChannels;
+        _maxOutputBlock = maxOutputBlock;
+
+        // Downsampling lowers the cutoff, so lengthen the filter to keep its transition band
+        const auto spec = specFor (quality);
+        const auto stretch = juce::jmax (1.0, _step);
+        _numTaps = juce::jmin (maxTaps, static_cast<int> (std::ceil (spec.taps * stretch / 4.0)) * 4);
+        _numPhases = spec.phases;
+        _interpolate = spec.interpolate;
+        buildTable (spec.cutoff / stretch, spec.beta);
+
+        const auto capacity = static_cast<size_t> (std::ceil (maxOutputBlock * _step)) + static_cast<size_t> (_numTaps) * 2 + 4;
+        _pending.assign (static_cast<size_t> (numChannels), std::vector<float> (capacity, 0.0f));
+        reset();
+    }
+
+    /** Clears the input history, as if starting a new stream. */
+    void reset() noexcept
+    {
+        for (auto& p : _pending)
+            std::fill (p.begin(), p.end(), 0.0f);
+
+        // Centre the first filter on the first input sample
+        _numPending = _numTaps / 2 - 1;
+        _time = 0.0;
+    }
+
+    //==============================================================================
+    /** Input samples per output sample. */
+    double ratio() const noexcept { return _step; }
+
+    /** Channels the resampler was prepared for. */
+    int numChannels() const noexcept { return _numChannels; }
+
+    /** Length of the filters in input samples. */
+    int numTaps() const noexcept { return _numTaps; }
+
+    /** Input samples process() needs to produce numOutput samples. */
+    int inputRequired (int numOutput) const noexcept
+    {
+        if (numOutput <= 0)
+            return 0;
+        const auto last = static_cast<int> (_time + (numOutput - 1) * _step);
+        return juce::jmax (0, last + _numTaps - _numPending);
+    }
+
+    /**
+     * Resample a block. Realtime safe.
+     *
+     * @param input             inputRequired (numOutput) samples for each prepared channel
+     * @param output            Receives numOutput samples per channel
+     * @param numOutputChannels Channels of output to write, at most the prepared count
+     * @param numOutput         Samples to produce, at most the prepared maximum block
+     */
+    void process (const float* const* input, float* const* output, int numOutputChannels, int numOutput) noexcept
+    {
+        jassert (numOutput <= _maxOutputBlock);
+        if (numOutput <= 0)
+            return;
+
+        const int numInput = inputRequired (numOutput);
+        for (int ch = 0; ch < _numChannels; ++ch)
+            juce::FloatVectorOperations::copy (_pending[(size_t) ch].data() + _numPending, input[ch], numInput);
+        _numPending += numInput;
+
+        const auto numPhases = static_cast<double> (_numPhases);
+        for (int ch = 0; ch < juce::jmin (numOutputChannels, _numChannels); ++ch) {
+            const float* data = _pending[(size_t) ch].data();
+            float* out = output[ch];
+            double time = _time;
+
+            for (int i = 0; i < numOutput; ++i, time += _step) {
+                const auto index = static_cast<int> (time);
+                const auto position = (time - index) * numPhases;
+                const auto phase = static_cast<int> (position);
+
+                if (_interpolate)
+                    out[i] = dot2 (data + index, filter (phase), filter (phase + 1), static_cast<float> (position - phase), _numTaps);
+                else
+                    out[i] = dot (data + index, filter (juce::roundToInt (position)), _numTaps);
+            }
+        }
+
+        // Keep what the next block's filters still need
+        const double end = _time + numOutput * _step;
+        const int consumed = juce::jmin (static_cast<int> (end), _numPending);
+        _time = end - consumed;
+        _numPending -= consumed;
+        for (auto& p : _pending)
+            std::memmove (p.data(), p.data() + consumed, sizeof (float) * static_cast<size_t> (_numPending));
+    }
+
+    /** Returns a display name for a quality level. */
+    static juce::String qualityName (Quality quality)
+    {
+        switch (quality) {
+            case Quality::Draft:
+                return "Draft";
+            case Quality::Standard:
+                return "Standard";
+            case Quality::High:
+                return "High";
+            case Quality::Maximum:
+                return "Maximum";
+        }
+        return {};
+    }
+
+private:
+    struct Spec {
+        int taps;
+        int phases;
+        bool interpolate;
+        double cutoff; // fraction of the lower Nyquist frequency
+        double beta;   // Kaiser window shape
+    };
+
+    static constexpr int maxTaps = 256;
+
+    double _step = 1.0;
+    int _numChannels = 0;
+    int _maxOutputBlock = 0;
+    int _numTaps = 4;
+    int _numPhases = 1;
+    bool _interpolate = false;
+
+    /** (numPhases + 1) filters of numTaps coefficients */
+    std::vector<float> _table;
+
+    /** Unconsumed input per channel, and the read position within it */
+    std::vector<std::vector<float>> _pending;
+    int _numPending = 0;
+    double _time = 0.0;
+
+    static Spec specFor (Quality quality) noexcept
+    {
+        switch (quality) {
+            case Quality::Draft:
+                return { 8, 64, false, 0.85, 5.0 };
+            case Quality::Standard:
+                return { 16, 128, true, 0.90, 6.5 };
+            case Quality::High:
+                return { 32, 256, true, 0.94, 8.5 };
+            case Quality::Maximum:
+                break;
+        }
+        return { 64, 512, true, 0.97, 10.0 };
+    }
+
+    const float* filter (int phase) const noexcept
+    {
+        return _table.data() + static_cast<size_t> (phase) * static_cast<size_t> (_numTaps);
+    }
+
+    static double bessel0 (double x) noexcept
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 64; ++k) {
+            const auto t = x / (2.0 * k);
+            term *= t * t;
+            sum += term;
+            if (term < sum * 1.0e-12)
+                break;
+        }
+        return sum;
+    }
+
+    void buildTable (double cutoff, double beta)
+    {
+        const auto half = _numTaps / 2;
+        const auto fc = 0.5 * cutoff;
+        const auto norm = bessel0 (beta);
+
+        _table.assign (static_cast<size_t> (_numPhases + 1) * static_cast<size_t> (_numTaps), 0.0f);
+        for (int p = 0; p <= _numPhases; ++p) {
+            const auto frac = static_cast<double> (p) / _numPhases;
+            auto* h = _table.data() + static_cast<size_t> (p) * static_cast<size_t> (_numTaps);
+
+            double sum = 0.0;
+            for (int k = 0; k < _numTaps; ++k) {
+                // Distance of this tap from the output position
+                const auto x = k - (half - 1) - frac;
+                const auto u = x / half;
+                const auto window = std::abs (u) < 1.0 ? bessel0 (beta * std::sqrt (1.0 - u * u)) / norm : 0.0;
+                const auto arg = juce::MathConstants<double>::pi * 2.0 * fc * x;
+                const auto sinc = std::abs (arg) < 1.0e-9 ? 1.0 : std::sin (arg) / arg;
+                const auto value = 2.0 * fc * sinc * window;
+                h[k] = static_cast<float> (value);
+                sum += value;
+            }
+
+            // Unity gain at DC for every phase
+            for (int k = 0; k < _numTaps; ++k)
+                h[k] = static_cast<float> (h[k] / sum);
+        }
+    }
+
+    //==============================================================================
+    static float dot (const float* x, const float* h, int n) noexcept
+    {
+#if RETUNER_RESAMPLER_SSE
+        __m128 acc = _mm_setzero_ps();
+        for (int k = 0; k < n; k += 4)
+            acc = _mm_add_ps (acc, _mm_mul_ps (_mm_loadu_ps (x + k), _mm_loadu_ps (h + k)));
+        return sum (acc);
+#elif RETUNER_RESAMPLER_NEON
+        float32x4_t acc = vdupq_n_f32 (0.0f);
+        for (int k = 0; k < n; k += 4)
+            acc = vmlaq_f32 (acc, vld1q_f32 (x + k), vld1q_f32 (h + k));
+        return sum (acc);
+#else
+        float acc = 0.0f;
+        for (int k = 0; k < n; ++k)
+            acc += x[k] * h[k];
+        return acc;
+#endif
+    }
+
+    /** Dot product with two filters, blended by frac. Each input sample is loaded once. */
+    static float dot2 (const float* x, const float* h0, const float* h1, float frac, int n) noexcept
+    {
+#if RETUNER_RESAMPLER_SSE
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+        for (int k = 0; k < n; k += 4) {
+            const auto v = _mm_loadu_ps (x + k);
+            acc0 = _mm_add_ps (acc0, _mm_mul_ps (v, _mm_loadu_ps (h0 + k)));
+            acc1 = _mm_add_ps (acc1, _mm_mul_ps (v, _mm_loadu_ps (h1 + k)));
+        }
+        const auto a = sum (acc0);
+        return a + frac * (sum (acc1) - a);
+#elif RETUNER_RESAMPLER_NEON
+        float32x4_t acc0 = vdupq_n_f32 (0.0f), acc1 = vdupq_n_f32 (0.0f);
+        for (int k = 0; k < n; k += 4) {
+            const auto v = vld1q_f32 (x + k);
+            acc0 = vmlaq_f32 (acc0, v, vld1q_f32 (h0 + k));
+            acc1 = vmlaq_f32 (acc1, v, vld1q_f32 (h1 + k));
+        }
+        const auto a = sum (acc0);
+        return a + frac * (sum (acc1) - a);
+#else
+        float acc0 = 0.0f, acc1 = 0.0f;
+        for (int k = 0; k < n; ++k) {
+            acc0 += x[k] * h0[k];
+            acc1 += x[k] * h1[k];
+        }
+        return acc0 + frac * (acc1 - acc0);
+#endif
+    }
+
+#if RETUNER_RESAMPLER_SSE
+    static float sum (__m128 v) noexcept
+    {
+        auto s = _mm_add_ps (v, _mm_movehl_ps (v, v));
+        s = _mm_add_ss (s, _mm_shuffle_ps (s, s, 1));
+        return _mm_cvtss_f32 (s);
+    }
+#elif RETUNER_RESAMPLER_NEON
+    static float sum (float32x4_t v) noexcept
+    {
+        const auto s = vadd_f32 (vget_low_f32 (v), vget_high_f32 (v));
+        return vget_lane_f32 (vpadd_f32 (s, s), 0);
+    }
+#endif
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Resampler)
+};
+
+} // namespace dsp
+} // namespace retuner
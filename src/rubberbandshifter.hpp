@@ -6,6 +6,7 @@
 #include <juce_core/juce_core.h>
 #include <juce_dsp/juce_dsp.h>
 #include <algorithm>
+#include <cmath>
 #include <type_traits>
 #include <iostream>
 
@@ -36,8 +37,22 @@ public:
 
         jassert (_sampleRate > SampleType (0) && _numChannels > 0);
 
-        // Prepare RubberBand stretcher in real-time mode
-        createOrReconfigureStretcher();
+        // Rebuilding the stretcher is expensive, so keep it when only the block
+        // size changed. Its window sizes and band and phase reset frequency
+        // limits all follow the rate it was built for, so any rate change rebuilds.
+        const bool reusable = _stretcher != nullptr && _stretcherChannels == _numChannels
+                              && _stretcherLowLatency == _lowLatency
+                              && juce::approximatelyEqual (static_cast<double> (_sampleRate), _stretcherSampleRate);
+        if (reusable) {
+            _stretcher->reset();
+            _stretcher->setMaxProcessSize (static_cast<size_t> (_maximumBlockSize));
+            _pushed = 0;
+            _retrieved = 0;
+            _discard = 0;
+            _prerolled = false;
+        } else {
+            createOrReconfigureStretcher();
+        }
 
         // Preallocate temp buffers (RubberBand uses float; we convert as needed)
         _rbIn.assign (static_cast<size_t> (_numChannels), std::vector<float> (static_cast<size_t> (_maximumBlockSize), 0.0f));
@@ -45,9 +60,12 @@ public:
 
         // Pointer arrays for process/retrieve
         _inPtrs.resize (static_cast<size_t> (_numChannels));
+        _inWritePtrs.resize (static_cast<size_t> (_numChannels));
         _outPtrs.resize (static_cast<size_t> (_numChannels));
+        _pullPtrs.resize (static_cast<size_t> (_numChannels));
         for (int ch = 0; ch < _numChannels; ++ch) {
             _inPtrs[(size_t) ch] = _rbIn[(size_t) ch].data();
+            _inWritePtrs[(size_t) ch] = _rbIn[(size_t) ch].data();
             _outPtrs[(size_t) ch] = _rbOut[(size_t) ch].data();
         }
     }
@@ -57,6 +75,10 @@ public:
     {
         if (_stretcher)
             _stretcher->reset();
+        _pushed = 0;
+        _retrieved = 0;
+        _discard = 0;
+        _prerolled = false;
         // Clear temp buffers
         for (auto& v : _rbIn)
             juce::FloatVectorOperations::clear (v.data(), (int) v.size());
@@ -73,6 +95,9 @@ public:
         const int numCh = juce::jmin (_numChannels, (int) inputBlock.getNumChannels());
         const int numSamples = (int) inputBlock.getNumSamples();
 
+        // In place processing needs equal input and output rates
+        jassert (juce::approximatelyEqual (_resampleRatio, 1.0));
+
         if (_stretcher == nullptr) {
             // Safety: if not configured, pass-through
             outputBlock.copyFrom (inputBlock);
@@ -99,6 +124,7 @@ public:
 
         // Process block (non-final)
         _stretcher->process (_inPtrs.data(), (size_t) numSamples, false);
+        _pushed += numSamples;
 
         // Try to retrieve exactly numSamples; if insufficient, zero-fill tail
         size_t avail = _stretcher->available();
@@ -107,6 +133,7 @@ public:
         if (avail > 0) {
             const int n = (int) std::min (static_cast<size_t> (toPull), avail);
             _stretcher->retrieve (_outPtrs.data(), (size_t) n);
+            _retrieved += n;
             pulled = n;
         }
 
@@ -126,13 +153,66 @@ public:
         }
     }
 
+    /**
+     * Pull-mode processing for when input and output run at different rates.
+     *
+     * Fills every output sample, asking @p readInput for as much input as the
+     * stretcher needs along the way. @p readInput is called as
+     * `readInput (float* const* channels, int numChannels, int numSamples)`
+     * and must fill every channel. It is never asked for more than the
+     * prepared maximum block size at once.
+     */
+    template <typename InputFunction>
+    void process (SampleType* const* output, int numChannels, int numSamples, InputFunction&& readInput) noexcept
+    {
+        static_assert (std::is_same_v<SampleType, float>, "Pull-mode processing is float only");
+
+        if (_stretcher == nullptr || numSamples <= 0)
+            return;
+
+        const int numCh = juce::jmin (numChannels, _numChannels);
+        int done = 0;
+
+        // Bound the work done per call in case the input stops producing
+        for (int attempts = 0; done < numSamples && attempts < 256; ++attempts) {
+            const auto avail = static_cast<int> (_stretcher->available());
+
+            // Drop the output for the pre-roll as it comes out
+            if (avail > 0 && _discard > 0) {
+                const int n = juce::jmin (avail, _discard, _maximumBlockSize);
+                _stretcher->retrieve (_outPtrs.data(), (size_t) n);
+                _discard -= n;
+                continue;
+            }
+
+            if (avail > 0) {
+                const int n = juce::jmin (avail, numSamples - done);
+                for (int ch = 0; ch < _numChannels; ++ch)
+                    _pullPtrs[(size_t) ch] = ch < numCh ? output[ch] + done : _rbOut[(size_t) ch].data();
+                _stretcher->retrieve (_pullPtrs.data(), (size_t) n);
+                _retrieved += n;
+                done += n;
+                continue;
+            }
+
+            const auto required = static_cast<int> (_stretcher->getSamplesRequired());
+            const int toRead = required > 0 ? juce::jmin (required, _maximumBlockSize) : _maximumBlockSize;
+            readInput (_inWritePtrs.data(), _numChannels, toRead);
+            _stretcher->process (_inPtrs.data(), (size_t) toRead, false);
+            _pushed += toRead;
+        }
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            juce::FloatVectorOperations::clear (output[ch] + done, numSamples - done);
+    }
+
     //==============================================================================
     /** Sets the pitch ratio. 1.0 = no change, 0.5 = one octave down, 2.0 = one octave up */
     void setPitchRatio (SampleType ratio) noexcept
     {
         _pitchRatio = ratio;
         if (_stretcher && ratio > SampleType (0))
-            _stretcher->setPitchScale (static_cast<float> (ratio));
+            _stretcher->setPitchScale (static_cast<float> (ratio / _resampleRatio));
     }
 
     /** Returns the current pitch ratio */
@@ -141,6 +221,74 @@ public:
         return _pitchRatio;
     }
 
+    /** Input wanted by preroll(), in input samples. */
+    int prerollLength() const noexcept
+    {
+        return _stretcher != nullptr ? static_cast<int> (_stretcher->getPreferredStartPad()) : 0;
+    }
+
+    /**
+     * Resets, then primes the stretcher so that its output starts straight away
+     * and lines up with the input instead of starting with the start delay.
+     * @p readInput, called as for pull-mode process(), is asked for
+     * prerollLength() samples: the audio leading up to where output should
+     * start. Carry on with pull-mode process() afterwards.
+     */
+    template <typename InputFunction>
+    void preroll (InputFunction&& readInput) noexcept
+    {
+        reset();
+        if (_stretcher == nullptr)
+            return;
+
+        for (int remaining = prerollLength(); remaining > 0;) {
+            const int n = juce::jmin (remaining, _maximumBlockSize);
+            readInput (_inWritePtrs.data(), _numChannels, n);
+            _stretcher->process (_inPtrs.data(), (size_t) n, false);
+            remaining -= n;
+        }
+
+        _discard = static_cast<int> (_stretcher->getStartDelay());
+        _prerolled = true;
+    }
+
+    /**
+     * Sets the ratio of output to input sample rate, folding sample rate conversion
+     * into the stretch. Input and output block sizes then differ, so feed the
+     * stretcher using pull-mode process(). 1.0 = no conversion
+     */
+    void setResampleRatio (double ratio) noexcept
+    {
+        jassert (ratio > 0.0);
+        _resampleRatio = ratio;
+        if (_stretcher) {
+            _stretcher->setTimeRatio (ratio);
+            _stretcher->setPitchScale (static_cast<float> (_pitchRatio / ratio));
+        }
+    }
+
+    /** Returns the output to input sample rate ratio. */
+    double resampleRatio() const noexcept { return _resampleRatio; }
+
+    /**
+     * Use a short analysis window for the least latency, e.g. for live input,
+     * at some cost in low frequency quality. Takes effect from the next prepare().
+     */
+    void setLowLatency (bool enabled) noexcept { _lowLatency = enabled; }
+
+    /** Returns the delay between input and output in output samples. This is the
+        stretcher's start delay, unless it was pre-rolled, plus whatever input it holds
+        that hasn't come out yet, which includes the silence emitted while priming
+        after the last reset. */
+    int latency() const noexcept
+    {
+        if (_stretcher == nullptr)
+            return 0;
+        const auto buffered = static_cast<double> (_pushed) * _resampleRatio - static_cast<double> (_retrieved);
+        const auto delay = _prerolled ? 0 : static_cast<int> (_stretcher->getStartDelay());
+        return delay + juce::roundToInt (buffered);
+    }
+
     /** Returns true if RubberBand library is available and enabled */
     static constexpr bool isAvailable() noexcept
     {
@@ -161,12 +309,33 @@ private:
     /** Current pitch ratio */
     SampleType _pitchRatio = SampleType (1.0);
 
+    /** Output to input sample rate ratio folded into the stretch */
+    double _resampleRatio = 1.0;
+
+    /** Short window requested and the one the stretcher was built with */
+    bool _lowLatency = false;
+    bool _stretcherLowLatency = false;
+
+    /** Rate and channel count the stretcher was built for */
+    double _stretcherSampleRate = 0.0;
+    int _stretcherChannels = 0;
+
+    /** Input pushed and output retrieved since the last reset, not counting pre-roll */
+    juce::int64 _pushed = 0;
+    juce::int64 _retrieved = 0;
+
+    /** Pre-roll output still to be dropped */
+    int _discard = 0;
+    bool _prerolled = false;
+
     // RubberBand stretcher and preallocated float buffers
     std::unique_ptr<RubberBand::RubberBandStretcher> _stretcher;
     std::vector<std::vector<float>> _rbIn;
     std::vector<std::vector<float>> _rbOut;
     std::vector<const float*> _inPtrs;
+    std::vector<float*> _inWritePtrs;
     std::vector<float*> _outPtrs;
+    std::vector<float*> _pullPtrs;
 
     void createOrReconfigureStretcher()
     {
@@ -174,16 +343,24 @@ private:
         const size_t options = (size_t) RBS::DefaultOptions
                                | (size_t) RBS::OptionProcessRealTime
                                | (size_t) RBS::OptionPitchHighConsistency
-                               | (size_t) RBS::OptionThreadingNever;
+                               | (size_t) RBS::OptionThreadingNever
+                               | (size_t) (_lowLatency ? RBS::OptionWindowShort : RBS::OptionWindowStandard);
 
         auto sampleRate = static_cast<size_t> (juce::roundToInt (_sampleRate));
         auto channelCount = static_cast<size_t> (_numChannels);
 
-        // Always recreate: RubberBand has no public API for changing sample rate or channel count in-place.
+        // Recreate: RubberBand has no public API for changing sample rate or channel count in-place.
         _stretcher = std::make_unique<RBS> (sampleRate, channelCount, options);
+        _stretcherSampleRate = static_cast<double> (_sampleRate);
+        _stretcherChannels = _numChannels;
+        _stretcherLowLatency = _lowLatency;
         _stretcher->setMaxProcessSize (static_cast<size_t> (_maximumBlockSize));
-        _stretcher->setTimeRatio (1.0);
-        _stretcher->setPitchScale (static_cast<float> (_pitchRatio));
+        _stretcher->setTimeRatio (_resampleRatio);
+        _stretcher->setPitchScale (static_cast<float> (_pitchRatio / _resampleRatio));
+        _pushed = 0;
+        _retrieved = 0;
+        _discard = 0;
+        _prerolled = false;
     }
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RubberBandShifter)
@@ -0,0 +1,166 @@
+#include <fstream>
+#include <juce_core/juce_core.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#include "../src/app/exporter.hpp"
+
+/** A tone of any length, generated as it's read rather than stored anywhere. */
+class SyntheticToneFormat : public juce::AudioFormat
+{
+public:
+    static constexpr double sampleRate = 8000.0;
+
+    explicit SyntheticToneFormat(double hours)
+        : juce::AudioFormat("Synthetic Tone", ".tone"), _length((juce::int64) (hours * 3600.0 * sampleRate)) {}
+
+    juce::int64 length() const noexcept { return _length; }
+
+    juce::Array<int> getPossibleSampleRates() override { return { (int) sampleRate }; }
+    juce::Array<int> getPossibleBitDepths() override { return { 32 }; }
+    bool canDoStereo() override { return false; }
+    bool canDoMono() override { return true; }
+
+    juce::AudioFormatReader* createReaderFor(juce::InputStream* stream, bool) override
+    {
+        return new Reader(stream, getFormatName(), _length);
+    }
+
+    std::unique_ptr<juce::AudioFormatWriter> createWriterFor(std::unique_ptr<juce::OutputStream>&,
+                                                             const juce::AudioFormatWriterOptions&) override
+    {
+        return nullptr;
+    }
+
+private:
+    juce::int64 _length;
+
+    class Reader : public juce::AudioFormatReader
+    {
+    public:
+        Reader(juce::InputStream* stream, const juce::String& name, juce::int64 length) : juce::AudioFormatReader(stream, name)
+        {
+            sampleRate = SyntheticToneFormat::sampleRate;
+            bitsPerSample = 32;
+            usesFloatingPointData = true;
+            lengthInSamples = length;
+            numChannels = 1;
+        }
+
+        bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                         juce::int64 startSampleInFile, int numSamples) override
+        {
+            for (int ch = 0; ch < numDestChannels; ++ch) {
+                auto* dest = reinterpret_cast<float*>(destChannels[ch]);
+                if (dest == nullptr)
+                    continue;
+
+                for (int i = 0; i < numSamples; ++i) {
+                    const auto position = startSampleInFile + i;
+                    const double t = (double) position / sampleRate;
+                    dest[startOffsetInDestBuffer + i] = position < lengthInSamples
+                        ? (float) (0.5 * std::sin(juce::MathConstants<double>::twoPi * 220.0 * t))
+                        : 0.0f;
+                }
+            }
+            return true;
+        }
+    };
+};
+
+class BoundedMemoryExportTest : public juce::UnitTest
+{
+public:
+    BoundedMemoryExportTest() : juce::UnitTest("Bounded Memory Export", "Export") {}
+
+    void runTest() override
+    {
+        juce::TemporaryFile input(".tone");
+        input.getFile().replaceWithText("synthetic");
+
+        beginTest("Limit too low to fit a window");
+        {
+            juce::TemporaryFile output(".wav");
+            auto settings = limitedSettings(juce::int64(8) << 20);
+            retuner::app::Exporter exporter;
+            exporter.formatManager().registerFormat(new SyntheticToneFormat(shortHours), false);
+            const auto result = exporter.exportAudio(input.getFile(), output.getFile(), settings, 440.0f, 432.0f);
+            expect(result.failed(), "An export that can't fit its limit should fail up front");
+            expect(result.getErrorMessage().contains("memory limit"), result.getErrorMessage());
+        }
+
+        // The full ten hours takes minutes and a few hundred MB of disk, so it
+        // only runs when asked for. Memory use doesn't grow with the length.
+        const bool longRun = juce::SystemStats::getEnvironmentVariable("RETUNER_LONG_TESTS", {}).getIntValue() > 0;
+        const auto hours = longRun ? longHours : shortHours;
+
+        beginTest(juce::String(hours) + " hours within the limit");
+        {
+            juce::TemporaryFile output(".wav");
+            const auto limit = juce::int64(128) << 20;
+            auto settings = limitedSettings(limit);
+
+            auto* format = new SyntheticToneFormat(hours);
+            retuner::app::Exporter exporter;
+            exporter.formatManager().registerFormat(format, false);
+
+            juce::int64 reportedPeak = 0, baseline = residentBytes(), residentPeak = baseline, midwaySize = 0;
+            int numReports = 0;
+
+            retuner::app::Exporter::ProgressCallback progress;
+            progress.onMemoryUsage = [&](juce::int64 bytes) {
+                reportedPeak = juce::jmax(reportedPeak, bytes);
+                residentPeak = juce::jmax(residentPeak, residentBytes());
+                ++numReports;
+            };
+            progress.onProgress = [&](double p) {
+                if (p >= 0.5 && midwaySize == 0)
+                    midwaySize = output.getFile().getSize();
+            };
+
+            const auto result = exporter.exportAudio(input.getFile(), output.getFile(), settings, 440.0f, 432.0f, progress);
+            expect(result.wasOk(), result.getErrorMessage());
+
+            expect(numReports > 0, "Memory use should be reported");
+            expect(reportedPeak > 0 && reportedPeak <= limit,
+                   "Reported " + juce::File::descriptionOfSizeInBytes(reportedPeak) + " against a limit of "
+                       + juce::File::descriptionOfSizeInBytes(limit));
+#if JUCE_LINUX
+            expect(residentPeak - baseline <= limit,
+                   "Resident memory grew by " + juce::File::descriptionOfSizeInBytes(residentPeak - baseline));
+#endif
+            expect(midwaySize > 0, "Output should be written as the export goes, not at the end");
+
+            std::unique_ptr<juce::AudioFormatReader> reader(juce::WavAudioFormat().createReaderFor(output.getFile().createInputStream().release(), true));
+            expect(reader != nullptr, "Output should be readable");
+            if (reader != nullptr)
+                expectEquals(reader->lengthInSamples, format->length());
+        }
+    }
+
+private:
+    static constexpr double shortHours = 0.25;
+    static constexpr double longHours = 10.0;
+
+    static retuner::app::Exporter::ExportSettings limitedSettings(juce::int64 limit)
+    {
+        auto settings = retuner::app::Exporter::preset(retuner::app::Exporter::Quality::Standard);
+        settings.bitDepth = 8; // keeps ten hours of output to a few hundred MB on disk
+        settings.memoryLimit = limit;
+        return settings;
+    }
+
+    /** Resident memory of this process, where the platform says. */
+    static juce::int64 residentBytes()
+    {
+#if JUCE_LINUX
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+            if (line.rfind("VmRSS:", 0) == 0)
+                return std::atoll(line.c_str() + 6) * 1024;
+#endif
+        return 0;
+    }
+};
+
+static BoundedMemoryExportTest boundedMemoryExportTest;
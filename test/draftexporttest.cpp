@@ -0,0 +1,75 @@
+#include <juce_core/juce_core.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#include "../src/app/exporter.hpp"
+
+class DraftExportTest : public juce::UnitTest
+{
+public:
+    DraftExportTest() : juce::UnitTest("Draft Export", "Export") {}
+
+    void runTest() override
+    {
+        juce::TemporaryFile input(".wav");
+        writeInput(input.getFile());
+
+        juce::TemporaryFile standard(".wav"), draft(".wav");
+        const auto standardSeconds = exportFile(input.getFile(), standard.getFile(), retuner::app::Exporter::Quality::Standard);
+        const auto draftSeconds = exportFile(input.getFile(), draft.getFile(), retuner::app::Exporter::Quality::Draft);
+
+        beginTest("Draft output is the input's length");
+        expectEquals(outputLength(draft.getFile()), (juce::int64) (seconds * sampleRate));
+        expectEquals(outputLength(standard.getFile()), (juce::int64) (seconds * sampleRate));
+
+        beginTest("Draft speed");
+        expect(standardSeconds > 0.0 && draftSeconds > 0.0, "Both exports should succeed");
+        if (standardSeconds > 0.0 && draftSeconds > 0.0)
+            logMessage("Standard " + juce::String(standardSeconds, 2) + " s, Draft " + juce::String(draftSeconds, 2)
+                       + " s: " + juce::String(standardSeconds / draftSeconds, 2) + "x faster");
+    }
+
+private:
+    static constexpr double sampleRate = 44100.0;
+    static constexpr double seconds = 20.0;
+
+    static void writeInput(const juce::File& file)
+    {
+        const int length = (int) (seconds * sampleRate);
+        juce::AudioBuffer<float> buffer(2, length);
+        for (int i = 0; i < length; ++i) {
+            const double t = i / sampleRate;
+            const auto value = (float) (0.3 * std::sin(juce::MathConstants<double>::twoPi * 220.0 * t)
+                                        + 0.2 * std::sin(juce::MathConstants<double>::twoPi * 331.0 * t));
+            buffer.setSample(0, i, value);
+            buffer.setSample(1, i, value);
+        }
+
+        file.deleteFile();
+        std::unique_ptr<juce::OutputStream> stream(file.createOutputStream().release());
+        auto options = juce::AudioFormatWriterOptions {}.withSampleRate(sampleRate).withNumChannels(2).withBitsPerSample(24);
+        auto writer = juce::WavAudioFormat().createWriterFor(stream, options);
+        writer->writeFromAudioSampleBuffer(buffer, 0, length);
+    }
+
+    /** Seconds taken, or 0 if the export failed. */
+    static double exportFile(const juce::File& input, const juce::File& output, retuner::app::Exporter::Quality quality)
+    {
+        auto settings = retuner::app::Exporter::preset(quality);
+        settings.bitDepth = 24;
+
+        output.deleteFile();
+        retuner::app::Exporter exporter;
+        const auto start = juce::Time::getMillisecondCounterHiRes();
+        const auto result = exporter.exportAudio(input, output, settings, 440.0f, 432.0f);
+        const auto elapsed = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0;
+        return result.wasOk() ? elapsed : 0.0;
+    }
+
+    static juce::int64 outputLength(const juce::File& file)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader(juce::WavAudioFormat().createReaderFor(file.createInputStream().release(), true));
+        return reader != nullptr ? reader->lengthInSamples : -1;
+    }
+};
+
+static DraftExportTest draftExportTest;
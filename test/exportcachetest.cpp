@@ -0,0 +1,106 @@
+#include <juce_core/juce_core.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#include "../src/app/exportcache.hpp"
+
+class ExportCacheTest : public juce::UnitTest
+{
+public:
+    ExportCacheTest() : juce::UnitTest("Export Cache", "Export") {}
+
+    void runTest() override
+    {
+        auto directory = juce::File::createTempFile("exportcache");
+        juce::TemporaryFile first(".wav"), second(".wav");
+        writeInput(first.getFile(), 0.25f);
+        writeInput(second.getFile(), 0.5f);
+
+        // Room for one entry but not two
+        const auto entryBytes = (juce::int64) numChannels * length * (juce::int64) sizeof(float);
+
+        beginTest("Miss, then hit");
+        {
+            retuner::app::ExportCache cache(directory, entryBytes * 3 / 2);
+            expect(fill(cache, first.getFile()), "A new file should be cached");
+
+            auto reader = createReader(first.getFile());
+            auto entry = cache.find(first.getFile(), *reader);
+            expect(entry.decoded, "The same file again should hit");
+            if (entry.spill != nullptr) {
+                juce::AudioBuffer<float> audio(numChannels, length);
+                entry.spill->read(audio, 0, length);
+                expectEquals(audio.getSample(1, length / 2), 0.25f);
+            }
+        }
+
+        beginTest("An edited file misses");
+        {
+            retuner::app::ExportCache cache(directory, entryBytes * 3 / 2);
+            first.getFile().setLastModificationTime(juce::Time::getCurrentTime() + juce::RelativeTime::minutes(1));
+
+            auto reader = createReader(first.getFile());
+            auto entry = cache.find(first.getFile(), *reader);
+            expect(! entry.decoded, "A newer file shouldn't use the old decode");
+        }
+
+        beginTest("Least recently used is evicted");
+        {
+            retuner::app::ExportCache cache(directory, entryBytes * 3 / 2);
+            expect(fill(cache, first.getFile()));
+            juce::Thread::sleep(1100); // modification times can be whole seconds
+            expect(fill(cache, second.getFile()));
+
+            auto firstReader = createReader(first.getFile());
+            auto secondReader = createReader(second.getFile());
+            expect(! cache.find(first.getFile(), *firstReader).decoded, "The older entry should be gone");
+            expect(cache.find(second.getFile(), *secondReader).decoded, "The newer entry should be kept");
+        }
+
+        directory.deleteRecursively();
+    }
+
+private:
+    static constexpr int numChannels = 2;
+    static constexpr int length = 4096;
+
+    static void writeInput(const juce::File& file, float value)
+    {
+        juce::AudioBuffer<float> buffer(numChannels, length);
+        for (int ch = 0; ch < numChannels; ++ch)
+            juce::FloatVectorOperations::fill(buffer.getWritePointer(ch), value, length);
+
+        file.deleteFile();
+        std::unique_ptr<juce::OutputStream> stream(file.createOutputStream().release());
+        auto options = juce::AudioFormatWriterOptions {}.withSampleRate(44100.0).withNumChannels(numChannels).withBitsPerSample(32);
+        auto writer = juce::WavAudioFormat().createWriterFor(stream, options);
+        writer->writeFromAudioSampleBuffer(buffer, 0, length);
+    }
+
+    static std::unique_ptr<juce::AudioFormatReader> createReader(const juce::File& file)
+    {
+        return std::unique_ptr<juce::AudioFormatReader>(juce::WavAudioFormat().createReaderFor(file.createInputStream().release(), true));
+    }
+
+    /** Decode a file into the cache as an export does. */
+    static bool fill(retuner::app::ExportCache& cache, const juce::File& file)
+    {
+        auto reader = createReader(file);
+        if (reader == nullptr)
+            return false;
+
+        auto entry = cache.find(file, *reader);
+        if (entry.spill == nullptr || entry.decoded)
+            return false;
+
+        juce::AudioBuffer<float> audio(numChannels, length);
+        reader->read(&audio, 0, length, 0, true, true);
+        if (! entry.spill->write(audio, 0, length) || ! entry.spill->finishWriting())
+            return false;
+
+        entry.spill.reset();
+        cache.commit(entry.key, file, *reader);
+        return true;
+    }
+};
+
+static ExportCacheTest exportCacheTest;
@@ -0,0 +1,141 @@
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#include "../src/app/playlistsource.hpp"
+
+class PlaylistSourceTest : public juce::UnitTest
+{
+public:
+    PlaylistSourceTest() : juce::UnitTest("Playlist Source", "Playback") {}
+
+    void runTest() override
+    {
+        juce::TimeSliceThread thread("Playlist Read-Ahead");
+        thread.startThread();
+
+        beginTest("Short first item is re-buffered across the join");
+        {
+            retuner::app::PlaylistSource playlist;
+            playlist.reset(std::make_unique<ConstantReader>(shortLength, 0.25f), {});
+
+            // The read-ahead runs past the end of the first item before the next is joined
+            auto buffering = std::make_unique<juce::BufferingAudioSource>(&playlist, thread, false, readAhead, 2);
+            buffering->prepareToPlay(blockSize, sampleRate);
+            expect(waitFor([&] { return playlist.hasReadPastEnd(); }), "Read-ahead should reach past the end");
+
+            expect(playlist.append(std::make_unique<ConstantReader>(longLength, 0.5f), {}, blockSize));
+            expect(playlist.hasReadPastEnd(), "Silence past the old end should still be flagged");
+
+            // As the engine does: start buffering over from the current position
+            buffering = std::make_unique<juce::BufferingAudioSource>(&playlist, thread, false, readAhead, 2);
+            buffering->prepareToPlay(blockSize, sampleRate);
+            buffering->setNextReadPosition(0);
+            expect(! playlist.hasReadPastEnd(), "Re-buffering should clear the flag");
+
+            const auto audio = readBlocks(*buffering, shortLength * 4);
+            expectRun(audio, 0, shortLength, 0.25f);
+            expectRun(audio, shortLength, audio.getNumSamples(), 0.5f);
+        }
+
+        beginTest("Long first item needs no re-buffer");
+        {
+            retuner::app::PlaylistSource playlist;
+            playlist.reset(std::make_unique<ConstantReader>(longLength, 0.25f), {});
+
+            juce::BufferingAudioSource buffering(&playlist, thread, false, readAhead, 2);
+            buffering.prepareToPlay(blockSize, sampleRate);
+            waitFor([&] { return playlist.getNextReadPosition() >= readAhead / 2; });
+
+            expect(playlist.append(std::make_unique<ConstantReader>(longLength, 0.5f), {}, blockSize));
+            expect(! playlist.hasReadPastEnd());
+        }
+
+        beginTest("Released items keep their place");
+        {
+            retuner::app::PlaylistSource playlist;
+            playlist.reset(std::make_unique<ConstantReader>(shortLength, 0.25f), {});
+            expect(playlist.append(std::make_unique<ConstantReader>(shortLength, 0.5f), {}, blockSize));
+            playlist.release(1);
+
+            expectEquals(playlist.numItems(), 2);
+            expectEquals(playlist.itemStart(1), (juce::int64) shortLength);
+            expectEquals(playlist.itemLength(0), (juce::int64) shortLength);
+
+            juce::AudioBuffer<float> audio(2, shortLength * 2);
+            playlist.setNextReadPosition(0);
+            playlist.getNextAudioBlock(juce::AudioSourceChannelInfo(audio));
+            expectRun(audio, 0, shortLength, 0.0f);
+            expectRun(audio, shortLength, shortLength * 2, 0.5f);
+        }
+
+        thread.stopThread(1000);
+    }
+
+private:
+    static constexpr double sampleRate = 44100.0;
+    static constexpr int blockSize = 512;
+    static constexpr int readAhead = 16384;
+    static constexpr int shortLength = 2000;
+    static constexpr int longLength = 200000;
+
+    /** Mono audio holding one value throughout. */
+    class ConstantReader : public juce::AudioFormatReader
+    {
+    public:
+        ConstantReader(juce::int64 length, float value) : juce::AudioFormatReader(nullptr, "Constant"), _value(value)
+        {
+            sampleRate = PlaylistSourceTest::sampleRate;
+            bitsPerSample = 32;
+            usesFloatingPointData = true;
+            lengthInSamples = length;
+            numChannels = 1;
+        }
+
+        bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                         juce::int64 startSampleInFile, int numSamples) override
+        {
+            for (int ch = 0; ch < numDestChannels; ++ch) {
+                auto* dest = reinterpret_cast<float*>(destChannels[ch]);
+                if (dest == nullptr)
+                    continue;
+
+                for (int i = 0; i < numSamples; ++i)
+                    dest[startOffsetInDestBuffer + i] = startSampleInFile + i < lengthInSamples ? _value : 0.0f;
+            }
+            return true;
+        }
+
+    private:
+        float _value;
+    };
+
+    template <typename Condition>
+    static bool waitFor(Condition condition)
+    {
+        for (int i = 0; i < 500 && ! condition(); ++i)
+            juce::Thread::sleep(2);
+        return condition();
+    }
+
+    static juce::AudioBuffer<float> readBlocks(juce::BufferingAudioSource& source, int numSamples)
+    {
+        juce::AudioBuffer<float> audio(2, numSamples);
+        for (int start = 0; start < numSamples; start += blockSize) {
+            juce::AudioSourceChannelInfo info(&audio, start, juce::jmin(blockSize, numSamples - start));
+            source.waitForNextAudioBlockReady(info, 1000);
+            source.getNextAudioBlock(info);
+        }
+        return audio;
+    }
+
+    void expectRun(const juce::AudioBuffer<float>& audio, int start, int end, float value)
+    {
+        int wrong = 0;
+        for (int i = start; i < end; ++i)
+            wrong += audio.getSample(0, i) == value ? 0 : 1;
+        expectEquals(wrong, 0, "Samples " + juce::String(start) + " to " + juce::String(end) + " should be " + juce::String(value));
+    }
+};
+
+static PlaylistSourceTest playlistSourceTest;
@@ -0,0 +1,143 @@
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#include "../src/resampler.hpp"
+
+class ResamplerTest : public juce::UnitTest
+{
+public:
+    ResamplerTest() : juce::UnitTest("Resampler", "DSP") {}
+
+    void runTest() override
+    {
+        using Quality = retuner::dsp::Resampler::Quality;
+        const Quality qualities[] = { Quality::Draft, Quality::Standard, Quality::High, Quality::Maximum };
+        const double maxErrors[] = { 1.0e-2, 1.0e-3, 2.0e-4, 2.0e-5 };
+
+        beginTest("Sine accuracy");
+        for (int i = 0; i < 4; ++i) {
+            testSineAccuracy(qualities[i], 44100.0, 48000.0, maxErrors[i]);
+            testSineAccuracy(qualities[i], 48000.0, 44100.0, maxErrors[i]);
+            testSineAccuracy(qualities[i], 44100.0, 96000.0, maxErrors[i]);
+        }
+
+        beginTest("Block size independence");
+        testBlockSizeIndependence();
+
+        beginTest("Throughput");
+        for (auto quality : qualities) {
+            benchmark(quality, 44100.0, 48000.0);
+            benchmark(quality, 44100.0, 96000.0);
+        }
+    }
+
+private:
+    static constexpr double frequency = 1000.0;
+
+    static float sine(double position, double sampleRate)
+    {
+        return (float) std::sin(juce::MathConstants<double>::twoPi * frequency * position / sampleRate);
+    }
+
+    /** Resamples a sine in irregular blocks and returns the output. */
+    static std::vector<float> resampleSine(retuner::dsp::Resampler& resampler, double inputRate, int numInput, int blockSeed)
+    {
+        std::vector<float> input((size_t) numInput);
+        for (int i = 0; i < numInput; ++i)
+            input[(size_t) i] = sine(i, inputRate);
+
+        std::vector<float> output;
+        std::vector<float> left(512), right(512);
+        float* outputs[] = { left.data(), right.data() };
+
+        juce::Random random(blockSeed);
+        int position = 0;
+        for (;;) {
+            const int n = 1 + random.nextInt(512);
+            const int needed = resampler.inputRequired(n);
+            if (position + needed > numInput)
+                break;
+
+            const float* inputs[] = { input.data() + position, input.data() + position };
+            resampler.process(inputs, outputs, 2, n);
+            position += needed;
+            output.insert(output.end(), left.begin(), left.begin() + n);
+        }
+
+        return output;
+    }
+
+    void testSineAccuracy(retuner::dsp::Resampler::Quality quality, double inputRate, double outputRate, double maxError)
+    {
+        retuner::dsp::Resampler resampler;
+        resampler.prepare(inputRate, outputRate, 2, 512, quality);
+
+        const auto output = resampleSine(resampler, inputRate, 100000, 1);
+        expect(output.size() > 1000, "Resampler should produce output");
+
+        // Skip the start, where the filter still overlaps the silence before the stream
+        double error = 0.0;
+        for (size_t i = (size_t) resampler.numTaps(); i < output.size(); ++i)
+            error = juce::jmax(error, (double) std::abs(output[i] - sine((double) i * resampler.ratio(), inputRate)));
+
+        logMessage(retuner::dsp::Resampler::qualityName(quality) + " " + juce::String(inputRate) + " -> " + juce::String(outputRate)
+                   + ": max error " + juce::String(juce::Decibels::gainToDecibels(error), 1) + " dB");
+        expect(error < maxError, "Resampled sine should match the ideal signal");
+    }
+
+    void testBlockSizeIndependence()
+    {
+        retuner::dsp::Resampler a, b;
+        a.prepare(44100.0, 48000.0, 2, 512, retuner::dsp::Resampler::Quality::High);
+        b.prepare(44100.0, 48000.0, 2, 512, retuner::dsp::Resampler::Quality::High);
+
+        const auto first = resampleSine(a, 44100.0, 50000, 1);
+        const auto second = resampleSine(b, 44100.0, 50000, 2);
+        const auto length = juce::jmin(first.size(), second.size());
+        expect(length > 1000, "Resampler should produce output");
+
+        bool same = true;
+        for (size_t i = 0; i < length; ++i)
+            same = same && std::abs(first[i] - second[i]) < 1.0e-6f;
+        expect(same, "Output should not depend on how the input was split into blocks");
+    }
+
+    void benchmark(retuner::dsp::Resampler::Quality quality, double inputRate, double outputRate)
+    {
+        const int blockSize = 512;
+        const int numInput = (int) inputRate * 10;
+
+        retuner::dsp::Resampler resampler;
+        resampler.prepare(inputRate, outputRate, 2, blockSize, quality);
+
+        juce::AudioBuffer<float> input(2, numInput);
+        juce::AudioBuffer<float> output(2, blockSize);
+        juce::Random random(3);
+        for (int ch = 0; ch < 2; ++ch)
+            for (int i = 0; i < numInput; ++i)
+                input.setSample(ch, i, random.nextFloat() * 2.0f - 1.0f);
+
+        const auto start = juce::Time::getMillisecondCounterHiRes();
+
+        juce::int64 produced = 0;
+        int position = 0;
+        for (;;) {
+            const int needed = resampler.inputRequired(blockSize);
+            if (position + needed > numInput)
+                break;
+
+            const float* inputs[] = { input.getReadPointer(0, position), input.getReadPointer(1, position) };
+            resampler.process(inputs, output.getArrayOfWritePointers(), 2, blockSize);
+            position += needed;
+            produced += blockSize;
+        }
+
+        const auto seconds = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0;
+        const auto rate = seconds > 0.0 ? (double) produced / seconds / 1.0e6 : 0.0;
+        logMessage(retuner::dsp::Resampler::qualityName(quality) + " " + juce::String(inputRate) + " -> " + juce::String(outputRate)
+                   + ": " + juce::String(rate, 1) + " Msamples/s per channel, stereo");
+        expect(produced > 0, "Benchmark should produce output");
+    }
+};
+
+static ResamplerTest resamplerTest;
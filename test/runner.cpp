@@ -2,6 +2,13 @@
 #include <juce_gui_basics/juce_gui_basics.h>
 
 #include "rubberbandtest.cpp"
+#include "resamplertest.cpp"
+#include "segmentedexporttest.cpp"
+#include "draftexporttest.cpp"
+#include "boundedmemoryexporttest.cpp"
+#include "wave64test.cpp"
+#include "exportcachetest.cpp"
+#include "playlistsourcetest.cpp"
 
 //==============================================================================
 int main()
@@ -0,0 +1,135 @@
+#include <juce_core/juce_core.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#include "../src/app/exporter.hpp"
+
+class SegmentedExportTest : public juce::UnitTest
+{
+public:
+    SegmentedExportTest() : juce::UnitTest("Segmented Export", "Export") {}
+
+    void runTest() override
+    {
+        juce::TemporaryFile input(".wav");
+        writeInput(input.getFile());
+
+        juce::TemporaryFile single(".wav"), serial(".wav"), parallel(".wav");
+        expect(exportFile(input.getFile(), single.getFile(), false, 1), "Single-stream export should succeed");
+        expect(exportFile(input.getFile(), serial.getFile(), true, 1), "Segmented export on one thread should succeed");
+        expect(exportFile(input.getFile(), parallel.getFile(), true, 3), "Segmented export on three threads should succeed");
+
+        const auto reference = readOutput(single.getFile());
+        const auto oneThread = readOutput(serial.getFile());
+        const auto threeThreads = readOutput(parallel.getFile());
+
+        beginTest("Deterministic across thread counts");
+        expectEquals(oneThread.getNumSamples(), threeThreads.getNumSamples());
+        bool identical = oneThread.getNumSamples() == threeThreads.getNumSamples();
+        for (int ch = 0; identical && ch < oneThread.getNumChannels(); ++ch)
+            identical = std::memcmp(oneThread.getReadPointer(ch), threeThreads.getReadPointer(ch),
+                                    sizeof(float) * (size_t) oneThread.getNumSamples()) == 0;
+        expect(identical, "Output should not depend on the number of threads");
+
+        beginTest("Length matches single-stream render");
+        expectEquals(oneThread.getNumSamples(), reference.getNumSamples());
+
+        beginTest("Seam quality");
+        const int numSegments = (int) std::lround(seconds / segmentSeconds);
+        for (int i = 1; i < numSegments; ++i)
+            checkSeam(reference, oneThread, (int) (i * segmentSeconds * sampleRate));
+    }
+
+private:
+    static constexpr double sampleRate = 44100.0;
+    static constexpr double seconds = 10.0;
+    static constexpr double segmentSeconds = 2.5;
+
+    /** Chords with a slow swell, so both level and phase move across the seams. */
+    static void writeInput(const juce::File& file)
+    {
+        const int length = (int) (seconds * sampleRate);
+        juce::AudioBuffer<float> buffer(2, length);
+        const double frequencies[] = { 220.0, 330.5, 554.4 };
+
+        for (int i = 0; i < length; ++i) {
+            const double t = i / sampleRate;
+            const double swell = 0.6 + 0.4 * std::sin(juce::MathConstants<double>::twoPi * 0.3 * t);
+            double left = 0.0, right = 0.0;
+            for (auto f : frequencies) {
+                left += std::sin(juce::MathConstants<double>::twoPi * f * t);
+                right += std::sin(juce::MathConstants<double>::twoPi * f * 1.002 * t + 0.5);
+            }
+            buffer.setSample(0, i, (float) (0.2 * swell * left));
+            buffer.setSample(1, i, (float) (0.2 * swell * right));
+        }
+
+        file.deleteFile();
+        std::unique_ptr<juce::OutputStream> stream(file.createOutputStream().release());
+        auto options = juce::AudioFormatWriterOptions {}.withSampleRate(sampleRate).withNumChannels(2).withBitsPerSample(24);
+        auto writer = juce::WavAudioFormat().createWriterFor(stream, options);
+        writer->writeFromAudioSampleBuffer(buffer, 0, length);
+    }
+
+    static bool exportFile(const juce::File& input, const juce::File& output, bool segmented, int numThreads)
+    {
+        auto settings = retuner::app::Exporter::preset(retuner::app::Exporter::Quality::Standard);
+        settings.bitDepth = 24;
+        settings.parallelSegments = segmented;
+        settings.segmentSeconds = segmentSeconds;
+        settings.numThreads = numThreads;
+
+        output.deleteFile();
+        retuner::app::Exporter exporter;
+        return exporter.exportAudio(input, output, settings, 440.0f, 432.0f).wasOk();
+    }
+
+    static juce::AudioBuffer<float> readOutput(const juce::File& file)
+    {
+        juce::AudioBuffer<float> buffer;
+        std::unique_ptr<juce::AudioFormatReader> reader(juce::WavAudioFormat().createReaderFor(file.createInputStream().release(), true));
+        if (reader != nullptr) {
+            buffer.setSize((int) reader->numChannels, (int) reader->lengthInSamples);
+            reader->read(&buffer, 0, buffer.getNumSamples(), 0, true, true);
+        }
+        return buffer;
+    }
+
+    static double rms(const juce::AudioBuffer<float>& buffer, int start, int length)
+    {
+        double sum = 0.0;
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            for (int i = start; i < start + length; ++i)
+                sum += (double) buffer.getSample(ch, i) * buffer.getSample(ch, i);
+        return std::sqrt(sum / (buffer.getNumChannels() * length));
+    }
+
+    static double largestStep(const juce::AudioBuffer<float>& buffer, int start, int length)
+    {
+        double step = 0.0;
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            for (int i = start + 1; i < start + length; ++i)
+                step = juce::jmax(step, (double) std::abs(buffer.getSample(ch, i) - buffer.getSample(ch, i - 1)));
+        return step;
+    }
+
+    /** Compares the level and smoothness around a seam with the single-stream render. */
+    void checkSeam(const juce::AudioBuffer<float>& reference, const juce::AudioBuffer<float>& segmented, int seam)
+    {
+        const int window = 1024;
+        const int span = (int) (0.5 * sampleRate);
+
+        for (int start = seam - span; start + window <= seam + span; start += window) {
+            const auto expected = rms(reference, start, window);
+            const auto actual = rms(segmented, start, window);
+            const auto difference = std::abs(juce::Decibels::gainToDecibels(actual) - juce::Decibels::gainToDecibels(expected));
+            expect(difference < 1.0, "Level near seam at " + juce::String(seam) + " is off by " + juce::String(difference, 2) + " dB");
+        }
+
+        // A click would show up as a jump far beyond anything in the reference
+        const auto step = largestStep(segmented, seam - span, 2 * span);
+        const auto referenceStep = largestStep(reference, seam - span, 2 * span);
+        expect(step < referenceStep * 1.25 + 1.0e-3, "Seam at " + juce::String(seam) + " has a discontinuity");
+    }
+};
+
+static SegmentedExportTest segmentedExportTest;
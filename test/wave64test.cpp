@@ -0,0 +1,103 @@
+#include <juce_core/juce_core.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#include "../src/app/wave64format.hpp"
+
+class Wave64Test : public juce::UnitTest
+{
+public:
+    Wave64Test() : juce::UnitTest("Wave64", "Export") {}
+
+    void runTest() override
+    {
+        beginTest("Round trip at every bit depth");
+        roundTrip(2, 16, 2.0f / 32768.0f);
+        roundTrip(3, 24, 2.0f / 8388608.0f);
+        roundTrip(6, 32, 0.0f);
+
+        beginTest("Sizes are filled in on flush");
+        {
+            juce::TemporaryFile file(".w64"), snapshot(".w64");
+            const auto source = makeSignal(2, 10000);
+
+            retuner::app::Wave64AudioFormat format;
+            auto writer = createWriter(format, file.getFile(), 2, 24);
+            expect(writer != nullptr);
+            if (writer == nullptr)
+                return;
+
+            writer->writeFromAudioSampleBuffer(source, 0, source.getNumSamples());
+            expect(writer->flush(), "Flush should succeed");
+
+            // The file as it stands mid-export should already read back whole
+            file.getFile().copyFileTo(snapshot.getFile());
+            auto reader = createReader(format, snapshot.getFile());
+            expect(reader != nullptr, "A flushed file should be readable");
+            if (reader != nullptr)
+                expectEquals(reader->lengthInSamples, (juce::int64) source.getNumSamples());
+
+            writer.reset();
+            expectEquals(file.getFile().getSize() % 8, (juce::int64) 0, "Chunks should end on an 8 byte boundary");
+        }
+    }
+
+private:
+    static juce::AudioBuffer<float> makeSignal(int numChannels, int numSamples)
+    {
+        juce::AudioBuffer<float> buffer(numChannels, numSamples);
+        juce::Random random(numChannels);
+        for (int ch = 0; ch < numChannels; ++ch)
+            for (int i = 0; i < numSamples; ++i)
+                buffer.setSample(ch, i, random.nextFloat() * 1.6f - 0.8f);
+        return buffer;
+    }
+
+    static std::unique_ptr<juce::AudioFormatWriter> createWriter(juce::AudioFormat& format, const juce::File& file, int numChannels, int bits)
+    {
+        file.deleteFile();
+        std::unique_ptr<juce::OutputStream> stream(file.createOutputStream().release());
+        auto options = juce::AudioFormatWriterOptions {}.withSampleRate(48000.0).withNumChannels(numChannels).withBitsPerSample(bits);
+        return format.createWriterFor(stream, options);
+    }
+
+    static std::unique_ptr<juce::AudioFormatReader> createReader(juce::AudioFormat& format, const juce::File& file)
+    {
+        return std::unique_ptr<juce::AudioFormatReader>(format.createReaderFor(file.createInputStream().release(), true));
+    }
+
+    void roundTrip(int numChannels, int bits, float tolerance)
+    {
+        juce::TemporaryFile file(".w64");
+        const auto source = makeSignal(numChannels, 20000);
+
+        retuner::app::Wave64AudioFormat format;
+        {
+            auto writer = createWriter(format, file.getFile(), numChannels, bits);
+            expect(writer != nullptr, "Should write " + juce::String(bits) + "-bit");
+            if (writer == nullptr)
+                return;
+            writer->writeFromAudioSampleBuffer(source, 0, source.getNumSamples());
+        }
+
+        auto reader = createReader(format, file.getFile());
+        expect(reader != nullptr, "Should read back " + juce::String(bits) + "-bit");
+        if (reader == nullptr)
+            return;
+
+        expectEquals((int) reader->numChannels, numChannels);
+        expectEquals(reader->lengthInSamples, (juce::int64) source.getNumSamples());
+        expectEquals(reader->sampleRate, 48000.0);
+        expect(reader->usesFloatingPointData == (bits == 32));
+
+        juce::AudioBuffer<float> result(numChannels, source.getNumSamples());
+        reader->read(&result, 0, result.getNumSamples(), 0, true, true);
+
+        float worst = 0.0f;
+        for (int ch = 0; ch < numChannels; ++ch)
+            for (int i = 0; i < source.getNumSamples(); ++i)
+                worst = juce::jmax(worst, std::abs(result.getSample(ch, i) - source.getSample(ch, i)));
+        expect(worst <= tolerance, juce::String(bits) + "-bit error " + juce::String(worst));
+    }
+};
+
+static Wave64Test wave64Test;